@@ -0,0 +1,100 @@
+#include <redis/command.hpp>
+#include <redis/types.hpp>
+
+#include <benchmark/benchmark.h>
+#include <map>
+#include <string>
+
+static void BM_encode_get(benchmark::State& state)
+{
+  std::string key = "user:1234:profile";
+
+  for (auto _ : state)
+  {
+    std::string out;
+    redis::command::encode(out, "GET", key);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_encode_get);
+
+static void BM_encode_set(benchmark::State& state)
+{
+  std::string key = "user:1234:profile";
+  std::string value(state.range(0), 'x');
+
+  for (auto _ : state)
+  {
+    std::string out;
+    redis::command::encode(out, "SET", key, value);
+    benchmark::DoNotOptimize(out);
+  }
+
+  state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_encode_set)->RangeMultiplier(32)->Range(16, 1 << 20);
+
+// commands appended to the same buffer, as the stream does when pipelining
+static void BM_encode_pipeline(benchmark::State& state)
+{
+  std::string out;
+
+  for (auto _ : state)
+  {
+    out.clear();
+    for (int64_t i = 0; i < state.range(0); i++)
+      redis::command::encode(out, "INCRBY", "counter", i);
+
+    benchmark::DoNotOptimize(out);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_encode_pipeline)->Arg(16)->Arg(256);
+
+static void BM_encode_hset_map(benchmark::State& state)
+{
+  std::map<std::string, std::string> fields;
+  for (int64_t i = 0; i < state.range(0); i++)
+    fields.emplace("field" + std::to_string(i), "value");
+
+  for (auto _ : state)
+  {
+    std::string out;
+    redis::command::encode(out, "HSET", "hash", fields);
+    benchmark::DoNotOptimize(out);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_encode_hset_map)->Arg(10)->Arg(1000);
+
+static void BM_encode_double(benchmark::State& state)
+{
+  double score = 1234.5678901234;
+
+  for (auto _ : state)
+  {
+    std::string out;
+    redis::command::encode(out, "ZADD", "leaderboard", score, "player");
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_encode_double);
+
+static void BM_serialize_vector(benchmark::State& state)
+{
+  redis::types::vector v;
+  for (int64_t i = 0; i < state.range(0); i++)
+    v.push_back(redis::types::string("value"));
+
+  for (auto _ : state)
+  {
+    std::string out;
+    v.serialize(out);
+    benchmark::DoNotOptimize(out);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_serialize_vector)->Arg(10)->Arg(1000);
@@ -0,0 +1,147 @@
+#include <redis/commands.hpp>
+#include <redis/parser.hpp>
+#include <redis/reply_decoder.hpp>
+#include <redis/resp_reader.hpp>
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::string bulk(size_t size)
+{
+  return "$" + std::to_string(size) + "\r\n" + std::string(size, 'x') + "\r\n";
+}
+
+// an array of `n` bulk strings of `size` bytes, like an MGET or LRANGE reply
+std::string array(size_t n, size_t size)
+{
+  std::string s = "*" + std::to_string(n) + "\r\n";
+  for (size_t i = 0; i < n; i++)
+    s += bulk(size);
+
+  return s;
+}
+
+// `depth` arrays nested in each other, with an integer at the bottom
+std::string nested(size_t depth)
+{
+  std::string s;
+  for (size_t i = 0; i < depth; i++)
+    s += "*1\r\n";
+
+  return s + ":1\r\n";
+}
+
+void parse(benchmark::State& state, const std::string& reply)
+{
+  for (auto _ : state)
+  {
+    redis::parser p;
+    benchmark::DoNotOptimize(p.parse(reply.data(), reply.size()));
+    benchmark::DoNotOptimize(*p);
+  }
+
+  state.SetBytesProcessed(state.iterations() * reply.size());
+}
+}  // namespace
+
+static void BM_parse_simple_string(benchmark::State& state)
+{
+  parse(state, "+OK\r\n");
+}
+BENCHMARK(BM_parse_simple_string);
+
+static void BM_parse_integer(benchmark::State& state)
+{
+  parse(state, ":1234567890\r\n");
+}
+BENCHMARK(BM_parse_integer);
+
+static void BM_parse_bulk(benchmark::State& state)
+{
+  parse(state, bulk(state.range(0)));
+}
+BENCHMARK(BM_parse_bulk)->RangeMultiplier(32)->Range(16, 1 << 20);
+
+static void BM_parse_array_of_small_strings(benchmark::State& state)
+{
+  parse(state, array(state.range(0), 8));
+}
+BENCHMARK(BM_parse_array_of_small_strings)->RangeMultiplier(10)->Range(10, 10000);
+
+static void BM_parse_deep_array(benchmark::State& state)
+{
+  parse(state, nested(state.range(0)));
+}
+BENCHMARK(BM_parse_deep_array)->Arg(4)->Arg(32)->Arg(256);
+
+// the reply arrives one byte at a time and the parse is retried on each,
+// the worst case of the stream read loop
+static void BM_parse_split_at_every_byte(benchmark::State& state)
+{
+  auto reply = array(state.range(0), 8);
+
+  for (auto _ : state)
+  {
+    for (size_t n = 1; n <= reply.size(); n++)
+    {
+      redis::parser p;
+      benchmark::DoNotOptimize(p.parse(reply.data(), n));
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * reply.size());
+}
+BENCHMARK(BM_parse_split_at_every_byte)->Arg(10)->Arg(100);
+
+static void BM_resp_reader_skip(benchmark::State& state)
+{
+  auto reply = array(state.range(0), 8);
+
+  for (auto _ : state)
+  {
+    redis::resp_reader r(reply.data(), reply.size());
+    benchmark::DoNotOptimize(r.skip());
+  }
+
+  state.SetBytesProcessed(state.iterations() * reply.size());
+}
+BENCHMARK(BM_resp_reader_skip)->RangeMultiplier(10)->Range(10, 10000);
+
+static void BM_decode_vector_of_strings(benchmark::State& state)
+{
+  auto reply = array(state.range(0), 8);
+
+  for (auto _ : state)
+  {
+    redis::resp_reader r(reply.data(), reply.size());
+    std::vector<std::string> out;
+    boost::system::error_code ec;
+
+    benchmark::DoNotOptimize(redis::decode_reply(r, out, ec));
+  }
+
+  state.SetBytesProcessed(state.iterations() * reply.size());
+}
+BENCHMARK(BM_decode_vector_of_strings)->RangeMultiplier(10)->Range(10, 10000);
+
+static void BM_decode_scores(benchmark::State& state)
+{
+  std::string reply = "*" + std::to_string(2 * state.range(0)) + "\r\n";
+  for (int64_t i = 0; i < state.range(0); i++)
+    reply += "$6\r\nmember\r\n$18\r\n0.3000000000000001\r\n";
+
+  for (auto _ : state)
+  {
+    redis::resp_reader r(reply.data(), reply.size());
+    std::vector<std::pair<std::string, double>> out;
+    boost::system::error_code ec;
+
+    benchmark::DoNotOptimize(redis::decode_reply(r, out, ec));
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_decode_scores)->Arg(100)->Arg(1000);
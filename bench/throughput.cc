@@ -0,0 +1,338 @@
+#include <redis/auto_batcher.hpp>
+#include <redis/commands.hpp>
+#include <redis/mock_server.hpp>
+#include <redis/stream.hpp>
+#include <redis/subscribed_stream.hpp>
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+// The benchmarks run against REDIS_BENCH_ADDRESS (host:port) if it is set,
+// e.g. a local redis-server, and against an in-process redis::mock_server
+// otherwise. The ones shaping the replies always use a mock server of their
+// own.
+namespace
+{
+std::string address()
+{
+  static std::unique_ptr<redis::mock_server> server;
+
+  if (auto env = std::getenv("REDIS_BENCH_ADDRESS"))
+    return env;
+
+  if (!server)
+    server = std::make_unique<redis::mock_server>();
+
+  return server->address();
+}
+
+// stores the value the GET benchmarks read
+void set_key(boost::asio::io_context& ioc, redis::stream& redis, size_t size)
+{
+  bool done = false;
+  redis.async_write([&](boost::system::error_code, bool) { done = true; },
+                    redis::cmd::set("key", std::string(size, 'x')));
+
+  while (!done)
+    ioc.run_one();
+}
+}  // namespace
+
+// `batch` commands written at once, waiting for all the replies
+static void BM_pipelined_get(benchmark::State& state)
+{
+  boost::asio::io_context ioc;
+  // the io_context would stop whenever all the replies are in
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream redis(ioc);
+  redis.connect(address());
+  set_key(ioc, redis, 64);
+
+  for (auto _ : state)
+  {
+    int64_t left = state.range(0);
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+      redis.async_write(
+          [&](boost::system::error_code, std::optional<std::string> v)
+          {
+            benchmark::DoNotOptimize(v);
+            left--;
+          },
+          redis::cmd::get("key"));
+    }
+
+    while (left > 0)
+      ioc.run_one();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  redis.close();
+}
+BENCHMARK(BM_pipelined_get)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+// the same GETs merged into MGETs by an auto_batcher
+static void BM_batched_get(benchmark::State& state)
+{
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream redis(ioc);
+  redis.connect(address());
+  set_key(ioc, redis, 64);
+
+  redis::auto_batcher batcher(redis);
+
+  for (auto _ : state)
+  {
+    int64_t left = state.range(0);
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+      batcher.async_get(
+          "key",
+          [&](boost::system::error_code, std::optional<std::string> v)
+          {
+            benchmark::DoNotOptimize(v);
+            left--;
+          });
+    }
+
+    while (left > 0)
+      ioc.run_one();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  redis.close();
+}
+BENCHMARK(BM_batched_get)->Arg(16)->Arg(256)->UseRealTime();
+
+static void BM_pipelined_get_untyped(benchmark::State& state)
+{
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream redis(ioc);
+  redis.connect(address());
+  set_key(ioc, redis, 64);
+
+  for (auto _ : state)
+  {
+    int64_t left = state.range(0);
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+      redis.async_write(
+          [&](redis::any_type v)
+          {
+            benchmark::DoNotOptimize(v);
+            left--;
+          },
+          "GET", "key");
+    }
+
+    while (left > 0)
+      ioc.run_one();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  redis.close();
+}
+BENCHMARK(BM_pipelined_get_untyped)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+static void BM_pipelined_set(benchmark::State& state)
+{
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream redis(ioc);
+  redis.connect(address());
+
+  std::string value(state.range(1), 'x');
+
+  for (auto _ : state)
+  {
+    int64_t left = state.range(0);
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+      redis.async_write([&](boost::system::error_code, bool) { left--; },
+                        redis::cmd::set("key", value));
+    }
+
+    while (left > 0)
+      ioc.run_one();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+  redis.close();
+}
+BENCHMARK(BM_pipelined_set)
+    ->Args({16, 64})
+    ->Args({256, 64})
+    ->Args({16, 64 * 1024})
+    ->UseRealTime();
+
+// replies of `range(0)` bytes written in random pieces of up to `range(1)`
+// bytes, each read on its own
+static void BM_split_reply(benchmark::State& state)
+{
+  redis::mock_server server(1);
+
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream redis(ioc);
+  redis.connect(server.address());
+  set_key(ioc, redis, state.range(0));
+
+  redis::mock_server::write_options options;
+  options.split        = state.range(1);
+  options.random_split = true;
+  options.split_delay  = std::chrono::microseconds(20);
+  server.set_write_options(options);
+
+  for (auto _ : state)
+  {
+    bool done = false;
+    redis.async_write(
+        [&](boost::system::error_code, std::optional<std::string> v)
+        {
+          benchmark::DoNotOptimize(v);
+          done = true;
+        },
+        redis::cmd::get("key"));
+
+    while (!done)
+      ioc.run_one();
+  }
+
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  redis.close();
+}
+BENCHMARK(BM_split_reply)
+    ->Args({1024, 16})
+    ->Args({64 * 1024, 4096})
+    ->Args({1024 * 1024, 65536})
+    ->UseRealTime();
+
+// the connection dropped in the middle of a reply until the stream is back
+static void BM_reconnect(benchmark::State& state)
+{
+  redis::mock_server server;
+
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream redis(ioc);
+  redis.connect(server.address());
+  set_key(ioc, redis, 64);
+
+  bool reconnected = false;
+  redis.set_on_reconnect([&] { reconnected = true; });
+
+  for (auto _ : state)
+  {
+    server.drop_next_reply(8);
+    reconnected = false;
+
+    redis.async_write([](boost::system::error_code,
+                         std::optional<std::string>) {},
+                      redis::cmd::get("key"));
+
+    while (!reconnected)
+      ioc.run_one();
+  }
+
+  redis.close();
+}
+BENCHMARK(BM_reconnect)->UseRealTime();
+
+// messages published through one connection and received on another
+static void BM_pubsub(benchmark::State& state)
+{
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::stream publisher(ioc);
+  redis::subscribed_stream subscriber(ioc);
+
+  publisher.connect(address());
+  subscriber.connect(address());
+
+  int64_t received = 0;
+  subscriber.subscribe("bench", [&](const std::string&, const std::string&)
+                       { received++; });
+
+  // the subscription is in place once a message gets through
+  while (received == 0)
+  {
+    publisher.async_write([](boost::system::error_code, int64_t) {},
+                          redis::typed_command<int64_t>("PUBLISH", "bench",
+                                                        "warm-up"));
+    ioc.run_for(std::chrono::milliseconds(10));
+  }
+
+  std::string message(state.range(1), 'x');
+
+  for (auto _ : state)
+  {
+    received = 0;
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+      publisher.async_write([](boost::system::error_code, int64_t) {},
+                            redis::typed_command<int64_t>("PUBLISH", "bench",
+                                                          message));
+    }
+
+    while (received < state.range(0))
+      ioc.run_one();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  publisher.close();
+  subscriber.close();
+}
+BENCHMARK(BM_pubsub)->Args({256, 64})->Args({256, 4096})->UseRealTime();
+
+// the subscriber read path alone, fed by a server side flood
+static void BM_pubsub_flood(benchmark::State& state)
+{
+  redis::mock_server server;
+
+  boost::asio::io_context ioc;
+  auto work = boost::asio::make_work_guard(ioc);
+
+  redis::subscribed_stream subscriber(ioc);
+  subscriber.connect(server.address());
+
+  int64_t received = 0;
+  subscriber.subscribe("bench", [&](const std::string&, const std::string&)
+                       { received++; });
+
+  while (received == 0)
+  {
+    server.flood("bench", "warm-up", 1);
+    ioc.run_for(std::chrono::milliseconds(10));
+  }
+
+  std::string message(state.range(1), 'x');
+
+  for (auto _ : state)
+  {
+    received = 0;
+    server.flood("bench", message, state.range(0));
+
+    while (received < state.range(0))
+      ioc.run_one();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  subscriber.close();
+}
+BENCHMARK(BM_pubsub_flood)
+    ->Args({10000, 64})
+    ->Args({10000, 4096})
+    ->UseRealTime();
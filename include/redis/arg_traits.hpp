@@ -0,0 +1,268 @@
+#ifndef REDIS_ARG_TRAITS_H
+#define REDIS_ARG_TRAITS_H
+
+#include <redis/number.hpp>
+#include <redis/types.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace redis
+{
+/**
+ * Appends `s` to `out` as a RESP bulk string.
+ **/
+inline void write_bulk(std::string& out, std::string_view s)
+{
+  out += '$';
+  out += std::to_string(s.size());
+  out += "\r\n";
+  out.append(s.data(), s.size());
+  out += "\r\n";
+}
+
+/**
+ * arg_traits<T> serializes a command argument of type T.
+ *
+ * Every specialization has the following functions:
+ *
+ *   // number of bulk strings the value is sent as
+ *   static size_t count(const T& value);
+ *
+ *   // appends the bulk strings to out, e.g. with write_bulk
+ *   static void write(std::string& out, const T& value);
+ *
+ * Besides the specializations below any range of supported values is sent as
+ *its elements, so a std::map can be passed straight to HSET or MSET.
+ *Specializing it makes a new type usable as an argument.
+ **/
+template<class T, class Enable = void>
+struct arg_traits;
+
+/**
+ * Returns whether T can be passed as a command argument.
+ **/
+template<class T, class = void>
+struct is_arg : std::false_type
+{
+};
+
+template<class T>
+struct is_arg<T, std::void_t<decltype(arg_traits<T>::count(
+                     std::declval<const T&>()))>> : std::true_type
+{
+};
+
+// the bulk string built-ins, shared by all the string-like types
+struct string_arg_traits
+{
+  static size_t count(std::string_view)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, std::string_view s)
+  {
+    write_bulk(out, s);
+  }
+};
+
+template<>
+struct arg_traits<std::string> : string_arg_traits
+{
+};
+
+template<>
+struct arg_traits<std::string_view> : string_arg_traits
+{
+};
+
+template<>
+struct arg_traits<const char*> : string_arg_traits
+{
+};
+
+template<>
+struct arg_traits<char*> : string_arg_traits
+{
+};
+
+// a character is a string of one byte, not its code
+template<>
+struct arg_traits<char>
+{
+  static size_t count(char)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, char c)
+  {
+    write_bulk(out, std::string_view(&c, 1));
+  }
+};
+
+/**
+ * Returns whether T is an integer sent as its decimal digits. bool and the
+ *wide characters aren't: Redis has no argument of their kind, so they have
+ *no traits and are rejected at compile time.
+ **/
+template<class T>
+inline constexpr bool is_integer_arg_v =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+    !std::is_same_v<T, char> && !std::is_same_v<T, wchar_t> &&
+    !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>;
+
+// commands only take bulk strings, numbers are sent as such
+template<class T>
+struct arg_traits<T, std::enable_if_t<is_integer_arg_v<T>>>
+{
+  static size_t count(T)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, T n)
+  {
+    write_bulk(out, std::to_string(n));
+  }
+};
+
+// shortest round trip, so scores keep their exact value
+template<class T>
+struct arg_traits<T, std::enable_if_t<std::is_floating_point_v<T>>>
+{
+  static size_t count(T)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, T d)
+  {
+    char buf[max_double_length];
+    write_bulk(out, format_double(d, buf));
+  }
+};
+
+// durations are sent as a count of their own unit, so the unit has to match
+// the command: seconds for EXPIRE or EX, milliseconds for PEXPIRE or PX
+template<class Rep, class Period>
+struct arg_traits<std::chrono::duration<Rep, Period>>
+{
+  static size_t count(const std::chrono::duration<Rep, Period>&)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out,
+                    const std::chrono::duration<Rep, Period>& d)
+  {
+    arg_traits<Rep>::write(out, d.count());
+  }
+};
+
+template<>
+struct arg_traits<redis::types::string>
+{
+  static size_t count(const redis::types::string&)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, const redis::types::string& rs)
+  {
+    rs.serialize(out);
+  }
+};
+
+template<>
+struct arg_traits<redis::types::integer>
+{
+  static size_t count(const redis::types::integer&)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, const redis::types::integer& ri)
+  {
+    write_bulk(out, std::to_string(*ri));
+  }
+};
+
+// a vector is sent as its elements
+template<>
+struct arg_traits<redis::types::vector>
+{
+  static size_t count(const redis::types::vector& vs)
+  {
+    return (*vs).size();
+  }
+
+  static void write(std::string& out, const redis::types::vector& vs)
+  {
+    for (auto&& v : *vs)
+    {
+      if (auto ri = boost::variant2::get_if<redis::types::integer>(&v))
+        arg_traits<redis::types::integer>::write(out, *ri);
+      else if (auto rs = boost::variant2::get_if<redis::types::string>(&v))
+        arg_traits<redis::types::string>::write(out, *rs);
+      else
+        write_bulk(out, "");
+    }
+  }
+};
+
+// field and value, or member and score
+template<class A, class B>
+struct arg_traits<std::pair<A, B>>
+{
+  using first_traits  = arg_traits<std::remove_const_t<A>>;
+  using second_traits = arg_traits<std::remove_const_t<B>>;
+
+  static size_t count(const std::pair<A, B>& p)
+  {
+    return first_traits::count(p.first) + second_traits::count(p.second);
+  }
+
+  static void write(std::string& out, const std::pair<A, B>& p)
+  {
+    first_traits::write(out, p.first);
+    second_traits::write(out, p.second);
+  }
+};
+
+// any other range: std::vector, std::map, std::span, ...
+template<class Range>
+struct arg_traits<
+    Range,
+    std::enable_if_t<
+        !std::is_convertible_v<const Range&, std::string_view> &&
+        is_arg<std::decay_t<
+            decltype(*std::begin(std::declval<const Range&>()))>>::value>>
+{
+  using value_type =
+      std::decay_t<decltype(*std::begin(std::declval<const Range&>()))>;
+
+  static size_t count(const Range& range)
+  {
+    size_t n = 0;
+    for (auto&& v : range)
+      n += arg_traits<value_type>::count(v);
+
+    return n;
+  }
+
+  static void write(std::string& out, const Range& range)
+  {
+    for (auto&& v : range)
+      arg_traits<value_type>::write(out, v);
+  }
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef REDIS_AUTO_BATCHER_H
+#define REDIS_AUTO_BATCHER_H
+
+#include <redis/completion.hpp>
+#include <redis/stream.hpp>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// keys, pairs or fields merged in a single command at most
+#ifndef DEFAULT_BATCH_SIZE
+#define DEFAULT_BATCH_SIZE 128
+#endif
+
+namespace redis
+{
+/**
+ * auto_batcher merges the single key commands issued close together into
+ *one command: GETs into an MGET, SETs into an MSET and the HGETs of a hash
+ *into an HMGET. The reply is split back to every caller.
+ *
+ * The commands are held until the end of the current turn of the event
+ *loop, or for a time window, then sent in the order they were issued: a
+ *read never overtakes an earlier write and the other way around. A batch
+ *reaching the maximum size sends everything held straight away.
+ *
+ * Unlike GET, MGET returns nil for keys holding another type of value.
+ *EXISTS isn't merged: the multi key form only returns a count.
+ *
+ * The stream must outlive the batcher. The commands held when the batcher
+ *is destroyed are sent.
+ **/
+class auto_batcher
+{
+public:
+  using duration = std::chrono::steady_clock::duration;
+
+public:
+  auto_batcher()               = delete;
+  auto_batcher(auto_batcher&)  = delete;
+  auto_batcher(auto_batcher&&) = delete;
+
+  /**
+   * @param s Is the stream the batches are sent through.
+   * @param window Is how long the first command of a batch waits for
+   *others, 0 for the end of the current turn of the event loop.
+   * @param max_batch Is the most keys, pairs or fields in a batch.
+   **/
+  auto_batcher(redis::stream& s, duration window = duration::zero(),
+               size_t max_batch = DEFAULT_BATCH_SIZE);
+
+  ~auto_batcher();
+
+  /**
+   * Gets a key, through an MGET.
+   *
+   * @param key Is the key to get.
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, std::optional<std::string>).
+   **/
+  template<class CompletionToken>
+  auto async_get(const std::string& key, CompletionToken&& token)
+  {
+    return boost::asio::async_initiate<
+        CompletionToken,
+        void(boost::system::error_code, std::optional<std::string>)>(
+        [this](auto&& handler, const std::string& key)
+        {
+          auto& b = open(get, key);
+
+          b.args.push_back(key);
+          b.readers.push_back(reader::element_type::make(
+              std::forward<decltype(handler)>(handler),
+              stream_.get_executor()));
+
+          added(b);
+        },
+        token, key);
+  }
+
+  /**
+   * Sets a key, through an MSET. Only plain SETs can be merged, a SET with
+   *options goes through the stream.
+   *
+   * @param key Is the key to set.
+   * @param value Is its value.
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code).
+   **/
+  template<class CompletionToken>
+  auto async_set(const std::string& key, const std::string& value,
+                 CompletionToken&& token)
+  {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(boost::system::error_code)>(
+        [this](auto&& handler, const std::string& key,
+               const std::string& value)
+        {
+          auto& b = open(set, key);
+
+          b.args.push_back(key);
+          b.args.push_back(value);
+          b.writers.push_back(writer::element_type::make(
+              std::forward<decltype(handler)>(handler),
+              stream_.get_executor()));
+
+          added(b);
+        },
+        token, key, value);
+  }
+
+  /**
+   * Gets a field of a hash, through an HMGET of the fields asked on the
+   *same hash.
+   *
+   * @param key Is the hash.
+   * @param field Is the field to get.
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, std::optional<std::string>).
+   **/
+  template<class CompletionToken>
+  auto async_hget(const std::string& key, const std::string& field,
+                  CompletionToken&& token)
+  {
+    return boost::asio::async_initiate<
+        CompletionToken,
+        void(boost::system::error_code, std::optional<std::string>)>(
+        [this](auto&& handler, const std::string& key,
+               const std::string& field)
+        {
+          auto& b = open(hget, key);
+
+          b.args.push_back(field);
+          b.readers.push_back(reader::element_type::make(
+              std::forward<decltype(handler)>(handler),
+              stream_.get_executor()));
+
+          added(b);
+        },
+        token, key, field);
+  }
+
+  /**
+   * Sends the commands held now.
+   **/
+  void flush();
+
+private:
+  enum kind
+  {
+    get,
+    set,
+    hget
+  };
+
+  using reader =
+      std::unique_ptr<completion<boost::system::error_code,
+                                 std::optional<std::string>>>;
+  using writer = std::unique_ptr<completion<boost::system::error_code>>;
+
+  struct batch
+  {
+    kind type;
+    // the command, then the hash for HMGET
+    std::vector<std::string> args;
+    // the callers, in the order of the args
+    std::vector<reader> readers;
+    std::vector<writer> writers;
+  };
+
+  // returns the batch a command of `type` on `key` joins, opening one if
+  // joining would reorder it with a command of the other direction
+  batch& open(kind type, const std::string& key);
+
+  // flushes a full batch, or makes sure the batches are flushed later
+  void added(batch& b);
+
+  void send(batch& b);
+
+private:
+  redis::stream& stream_;
+
+  duration window_;
+  size_t max_batch_;
+
+  // in the order they were opened
+  std::deque<batch> batches_;
+  // indexes in batches_ of the batches commands can join, and of the last
+  // batch of reads and of writes opened
+  size_t get_;
+  size_t set_;
+  std::unordered_map<std::string, size_t> hgets_;
+  size_t last_read_;
+  size_t last_write_;
+
+  boost::asio::steady_timer timer_;
+  bool is_armed_;
+};
+}  // namespace redis
+
+#endif
@@ -3,10 +3,60 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
 #include <boost/core/ignore_unused.hpp>
+#include <redis/error.hpp>
+#include <redis/tracing.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// seconds the addresses a host resolved to are reused for
+#ifndef DEFAULT_RESOLVE_TTL
+#define DEFAULT_RESOLVE_TTL 30
+#endif
 
 namespace redis
 {
+/**
+ * TLS settings of a connection, see basic_stream::set_tls.
+ **/
+struct tls_options
+{
+  // sent as SNI and checked against the certificate. Empty sends no SNI and
+  // skips the host name check.
+  std::string server_name;
+  // TLS 1.2 cipher list and TLS 1.3 cipher suites in the OpenSSL format,
+  // empty keeps the defaults of the context
+  std::string ciphers;
+  std::string ciphersuites;
+  // ALPN protocols offered, none if empty
+  std::vector<std::string> alpn;
+  bool verify_peer = true;
+};
+
+/**
+ * The commands sent on every connection before any other, see
+ *basic_stream::set_handshake.
+ **/
+struct handshake_options
+{
+  // AUTH, as the default user if `user` is empty. None if both are empty.
+  std::string user;
+  std::string password;
+  // CLIENT SETNAME, if not empty
+  std::string client_name;
+  // SELECT, if not 0
+  int database = 0;
+  // sends a single HELLO 2 carrying the AUTH and the SETNAME instead, Redis
+  // 6 and later
+  bool hello = false;
+  // sent last, e.g. {"CLIENT", "NO-EVICT", "ON"}
+  std::vector<std::vector<std::string>> commands;
+};
+
 class basic_stream
 {
 public:
@@ -14,7 +64,8 @@ public:
   using on_stream_closed_cb = std::function<void(boost::system::error_code)>;
   using on_reconnect_cb     = std::function<void()>;
 
-  using asio_stream = boost::asio::ip::tcp::socket;
+  // TCP or, where supported, unix domain sockets
+  using asio_stream = boost::asio::generic::stream_protocol::socket;
 
 public:
   basic_stream()               = delete;
@@ -23,8 +74,14 @@ public:
 
   basic_stream(boost::asio::io_context& ioc);
 
+  ~basic_stream();
+
   asio_stream::executor_type get_executor();
 
+  /**
+   * Connects to `host:port`, or to a unix domain socket given as
+   *`unix:///path/to/redis.sock`. Reconnections go to the same address.
+   **/
   void connect(const std::string& hostport);
   void connect(const std::string& hostport, boost::system::error_code& ec);
 
@@ -32,57 +89,135 @@ public:
   void connect(const std::string& host, const std::string& port,
                boost::system::error_code& ec);
 
-  void async_connect(const std::string& hostport, on_connect_cb cb);
+  /**
+   * Establishes a connection asynchronously.
+   *
+   * @param token Is the completion token, with signature
+   *void(boost::system::error_code).
+   **/
+  template<typename CompletionToken>
+  auto async_connect(const std::string& hostport, CompletionToken&& token)
+  {
+    if (is_local(hostport))
+      return async_connect(hostport, "", std::forward<CompletionToken>(token));
+
+    std::vector<std::string> v{2};
+    boost::split(v, hostport, boost::is_any_of(":"));
 
-  void async_connect(const std::string& host, const std::string& port,
-                     on_connect_cb cb);
+    return async_connect(v[0], v[1], std::forward<CompletionToken>(token));
+  }
 
-  template<typename MutableBuffer, typename Callback>
-  void async_read_some(MutableBuffer&& buffer, Callback cb)
+  template<typename CompletionToken>
+  auto async_connect(const std::string& host, const std::string& port,
+                     CompletionToken&& token)
   {
-    stream_.async_read_some(buffer,
-                            [this, cb](auto&& ec, auto&& bytes_read)
-                            {
-                              if (ec)
-                              {
-                                reconnect_report(ec);
-                              }
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code)>(
+        connect_op{this, lifetime_, host, port, nullptr}, token, stream_);
+  }
 
-                              // TODO: report the error?
-                              cb(ec, bytes_read);
-                            });
+  /**
+   * Reads some data. A failure starts the reconnection.
+   *
+   * @param token Is the completion token, with signature
+   *void(boost::system::error_code, size_t).
+   **/
+  template<typename MutableBuffer, typename CompletionToken>
+  auto async_read_some(const MutableBuffer& buffer, CompletionToken&& token)
+  {
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code, size_t)>(
+        io_op<MutableBuffer, read_some>{this, lifetime_, buffer, false}, token, stream_);
   }
 
-  template<typename ConstBuffer, typename Callback>
-  void async_write_some(ConstBuffer&& buffer, Callback cb)
+  template<typename ConstBuffer, typename CompletionToken>
+  auto async_write_some(const ConstBuffer& buffer, CompletionToken&& token)
   {
-    stream_.async_write_some(buffer,
-                             [this, cb](auto&& ec, auto bytes_written)
-                             {
-                               if (ec)
-                               {
-                                 reconnect_report(ec);
-                               }
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code, size_t)>(
+        io_op<ConstBuffer, write_some>{this, lifetime_, buffer, false}, token, stream_);
+  }
 
-                               cb(ec, bytes_written);
-                             });
+  template<typename ConstBuffer, typename CompletionToken>
+  auto async_write(const ConstBuffer& buffer, CompletionToken&& token)
+  {
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code, size_t)>(
+        io_op<ConstBuffer, write_all>{this, lifetime_, buffer, false}, token, stream_);
   }
 
-  template<typename ConstBuffer, typename Callback>
-  void async_write(ConstBuffer&& buffer, Callback&& cb)
+  /**
+   * Makes the following connections use TLS. Every connection, the
+   *reconnections included, resumes the TLS session of the previous one when
+   *the server allows it, so reconnecting costs no full handshake.
+   *
+   * Throws a boost::system::error_code if the ciphers aren't valid.
+   *
+   * @param ctx Is the context the connections are made with. It must
+   *outlive the stream. The ciphers and the session cache mode are set on it.
+   **/
+  void set_tls(boost::asio::ssl::context& ctx, tls_options options = {});
+  void set_tls(boost::asio::ssl::context& ctx, tls_options options,
+               boost::system::error_code& ec);
+
+  /**
+   * Returns whether the current TLS connection resumed the previous session.
+   **/
+  bool session_reused();
+
+  /**
+   * Sets the commands sent first on every connection, the reconnections and
+   *the spare connections taking over included, all in one write. A
+   *connection only counts as made, for connect, async_connect and the
+   *on_reconnect callback, once every one of them succeeded, so nothing else
+   *reaches a connection that isn't authenticated or on the right database.
+   *
+   * If the server replies with an error, e.g. a wrong password or LOADING,
+   *the connection is closed and fails with redis::errc::handshake_failed. A
+   *reconnection failing so is made again a second later, as any other.
+   *
+   * Takes effect on the next connection.
+   *
+   * @param options Are the credentials, client name, database and other
+   *commands to send.
+   **/
+  void set_handshake(handshake_options options);
+
+  /**
+   * Returns the error the server replied to the last handshake, empty if it
+   *succeeded.
+   **/
+  const std::string& handshake_error() const
   {
-    boost::asio::async_write(stream_, buffer,
-                             [this, cb](auto&& ec, auto bytes_written)
-                             {
-                               if (ec)
-                               {
-                                 reconnect_report(ec);
-                               }
+    return handshake_error_;
+  }
 
-                               cb(ec, bytes_written);
-                             });
+  /**
+   * Sets how long the addresses a host resolved to are reused by the
+   *following connections, DEFAULT_RESOLVE_TTL seconds by default. If they
+   *can't be connected to the host is resolved again straight away.
+   *
+   * @param ttl Is how long to reuse them, 0 to resolve on every connection.
+   **/
+  void set_resolve_ttl(std::chrono::steady_clock::duration ttl)
+  {
+    resolve_ttl_ = ttl;
   }
 
+  /**
+   * Keeps spare connections open to the server, made as soon as the stream
+   *is connected. When the connection is lost one of them takes its place at
+   *once instead of resolving and connecting again; only the TLS handshake
+   *is done then, resuming the session.
+   *
+   * A spare connection closed by the server, e.g. by its idle timeout, is
+   *replaced. Nothing is sent on it until it takes over, so the handshake,
+   *see set_handshake, still costs its round trip then.
+   *
+   * @param count Is how many to keep, 0 for none.
+   **/
+  void set_standby(size_t count);
+
   void set_on_stream_closed(on_stream_closed_cb cb)
   {
     on_stream_closed_cb_ = cb;
@@ -102,17 +237,350 @@ public:
   {
     is_closed_ = true;
     stream_.close();
+
+    close_standby();
+  }
+
+  /**
+   * Drops the connection and reconnects, as if it had been lost.
+   *
+   * @param ec Is the reason reported to the on_stream_closed callback.
+   **/
+  void recycle(boost::system::error_code ec)
+  {
+    reconnect_report(ec);
   }
 
 private:
+  enum io_kind
+  {
+    read_some,
+    write_some,
+    write_all
+  };
+
+  // reads or writes, reporting a failure before completing
+  template<typename Buffer, io_kind Kind>
+  struct io_op
+  {
+    basic_stream* stream;
+    // expired if the stream was destroyed with the operation in flight
+    std::weak_ptr<void> lifetime;
+    Buffer buffer;
+    bool started;
+
+    template<typename Self>
+    void operator()(Self& self, boost::system::error_code ec = {},
+                    size_t bytes = 0)
+    {
+      if (!started)
+      {
+        started = true;
+
+        if (stream->ssl_)
+          return start(*stream->ssl_, self);
+
+        return start(stream->stream_, self);
+      }
+
+      // closed and destroyed before the completion ran, like a read still
+      // waiting for the late reply of a command timed out: nobody is left to
+      // complete
+      if (lifetime.expired())
+        return;
+
+      if (ec)
+        stream->reconnect_report(ec);
+
+      self.complete(ec, bytes);
+    }
+
+    template<typename AsyncStream, typename Self>
+    void start(AsyncStream& s, Self& self)
+    {
+      if constexpr (Kind == read_some)
+        s.async_read_some(buffer, std::move(self));
+      else if constexpr (Kind == write_some)
+        s.async_write_some(buffer, std::move(self));
+      else
+        boost::asio::async_write(s, buffer, std::move(self));
+    }
+  };
+
+  // resolves the host and connects to the first endpoint that accepts, then
+  // does the TLS handshake if enabled and sends the commands of
+  // set_handshake if any
+  struct connect_op
+  {
+    basic_stream* stream;
+    // expired if the stream was destroyed while connecting, see io_op
+    std::weak_ptr<void> lifetime;
+    std::string host;
+    std::string port;
+    std::unique_ptr<boost::asio::ip::tcp::resolver> resolver;
+    bool handshaking = false;
+    bool handshake_sent = false;
+    // connecting to the addresses resolved before
+    bool cached = false;
+
+    template<typename Self>
+    void operator()(Self& self)
+    {
+      if (stream->stream_.is_open())
+        stream->close();
+
+      stream->original_host_ = host;
+      stream->original_port_ = port;
+
+      if (is_local(host))
+      {
+        boost::system::error_code ec;
+        auto endpoint = local_endpoint(host, ec);
+        if (!ec)
+          return stream->stream_.async_connect(endpoint, std::move(self));
+
+        return boost::asio::post(stream->stream_.get_executor(),
+                                 [self = std::move(self), ec]() mutable
+                                 { self(ec); });
+      }
+
+      if (stream->is_resolved(host, port))
+      {
+        cached = true;
+        return boost::asio::async_connect(stream->stream_, stream->endpoints_,
+                                          std::move(self));
+      }
+
+      resolve(self);
+    }
+
+    template<typename Self>
+    void resolve(Self& self)
+    {
+      resolver = std::make_unique<boost::asio::ip::tcp::resolver>(
+          stream->stream_.get_executor());
+
+      auto& r = *resolver;
+      r.async_resolve(host, port, std::move(self));
+    }
+
+    template<typename Self>
+    void operator()(Self& self, boost::system::error_code ec,
+                    boost::asio::ip::tcp::resolver::results_type results)
+    {
+      if (lifetime.expired())
+        return;
+
+      if (ec)
+        return self.complete(ec);
+
+      stream->resolved(host, port, results);
+
+      boost::asio::async_connect(stream->stream_, stream->endpoints_,
+                                 std::move(self));
+    }
+
+    template<typename Self>
+    void operator()(Self& self, boost::system::error_code ec,
+                    const asio_stream::endpoint_type&)
+    {
+      (*this)(self, ec);
+    }
+
+    template<typename Self>
+    void operator()(Self& self, boost::system::error_code ec)
+    {
+      if (lifetime.expired())
+        return;
+
+      // the host may have moved
+      if (ec && cached && !handshaking && !handshake_sent)
+      {
+        cached = false;
+        stream->endpoints_.clear();
+
+        return resolve(self);
+      }
+
+      if (!ec && !handshaking && stream->tls_context_)
+      {
+        handshaking = true;
+        stream->start_tls();
+
+        return stream->ssl_->async_handshake(
+            boost::asio::ssl::stream_base::client, std::move(self));
+      }
+
+      if (!ec && !handshake_sent && !stream->handshake_.empty())
+      {
+        handshake_sent = true;
+        return stream->async_send_handshake(std::move(self));
+      }
+
+      if (ec && handshake_sent)
+      {
+        boost::system::error_code ignored;
+        stream->stream_.close(ignored);
+      }
+
+      if (!ec)
+      {
+        stream->is_closed_ = false;
+
+        stream->stream_.non_blocking(true);
+
+        trace::emit(
+            [&] {
+              return trace::event{trace::event_type::connected, stream};
+            });
+
+        stream->fill_standby();
+      }
+
+      self.complete(ec);
+    }
+  };
+
+  // writes the commands of set_handshake and reads their replies
+  struct handshake_op
+  {
+    basic_stream* stream;
+    std::weak_ptr<void> lifetime;
+    bool started = false;
+    // size of the replies before the read in flight
+    size_t filled = 0;
+
+    template<typename Self>
+    void operator()(Self& self, boost::system::error_code ec = {},
+                    size_t bytes = 0)
+    {
+      if (lifetime.expired())
+        return;
+
+      auto& replies = stream->handshake_replies_;
+
+      if (!started)
+      {
+        started = true;
+        replies.clear();
+
+        auto buffer = boost::asio::buffer(stream->handshake_);
+        if (stream->ssl_)
+          return boost::asio::async_write(*stream->ssl_, buffer,
+                                          std::move(self));
+        return boost::asio::async_write(stream->stream_, buffer,
+                                        std::move(self));
+      }
+
+      if (ec)
+        return self.complete(ec);
+
+      // bytes were written the first time, read otherwise
+      if (filled != replies.size())
+        replies.resize(filled + bytes);
+
+      if (stream->handshake_replied(ec))
+        return self.complete(ec);
+
+      filled = replies.size();
+      replies.resize(filled + handshake_read_size);
+
+      auto buffer =
+          boost::asio::buffer(&replies[filled], handshake_read_size);
+      if (stream->ssl_)
+        return stream->ssl_->async_read_some(buffer, std::move(self));
+      stream->stream_.async_read_some(buffer, std::move(self));
+    }
+  };
+
+  static constexpr size_t handshake_read_size = 1024;
+
+  template<typename CompletionToken>
+  auto async_send_handshake(CompletionToken&& token)
+  {
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code)>(
+        handshake_op{this, lifetime_}, token, stream_);
+  }
+
+  // writes the handshake and waits for its replies
+  void send_handshake(boost::system::error_code& ec);
+
+  // whether every reply of the handshake was read, setting `ec` if one of
+  // them is an error
+  bool handshake_replied(boost::system::error_code& ec);
+
+  // the resolved TCP endpoints as endpoints of asio_stream
+  static std::vector<asio_stream::endpoint_type> endpoints(
+      const boost::asio::ip::tcp::resolver::results_type& results);
+
+  // whether the address is a unix:// one
+  static bool is_local(const std::string& host);
+
+  static asio_stream::endpoint_type local_endpoint(
+      const std::string& host, boost::system::error_code& ec);
+
+  // whether the addresses of host:port resolved before can be reused
+  bool is_resolved(const std::string& host, const std::string& port) const;
+
+  void resolved(const std::string& host, const std::string& port,
+                const boost::asio::ip::tcp::resolver::results_type& results);
+
+  // a spare connection, see set_standby
+  struct standby
+  {
+    explicit standby(const asio_stream::executor_type& ex)
+        : socket(ex)
+        , ready(false)
+    {
+    }
+
+    asio_stream socket;
+    bool ready;
+    // a read that only completes if the server closes the connection
+    char probe;
+  };
+
+  // opens spare connections until there are as many as wanted
+  void fill_standby();
+  void close_standby();
+  void watch(std::shared_ptr<standby> s);
+  void drop(const std::shared_ptr<standby>& s);
+
+  // makes a spare connection the connection, returns false if none is
+  // ready
+  bool swap_standby();
+  // the TLS handshake of the spare connection is done, if any
+  void on_swapped_tls(boost::system::error_code ec);
+  void on_swapped(boost::system::error_code ec);
+
+  // creates the TLS stream of a new connection
+  void start_tls();
+
+  // keeps the session OpenSSL hands out after a handshake
+  static int on_new_session(SSL* ssl, SSL_SESSION* session);
+
   void reconnect_report(boost::system::error_code);
   void reconnect();
 
 private:
-  // TODO: boost::asio::ssl::stream support SSL
-  // implementing ssl will require a std::optional.
-  // the SSL can't reset so optional is the best option
   asio_stream stream_;
+  // an ssl::stream can't be reused, a new one is made on every connection
+  std::optional<boost::asio::ssl::stream<asio_stream&>> ssl_;
+
+  boost::asio::ssl::context* tls_context_;
+  tls_options tls_options_;
+  // tls_options_.alpn in wire format
+  std::string alpn_;
+  // session of the last connection, resumed by the next one
+  std::unique_ptr<SSL_SESSION, void (*)(SSL_SESSION*)> session_;
+
+  // the commands of set_handshake encoded, and how many there are
+  std::string handshake_;
+  size_t handshake_count_;
+  // the replies read so far by the handshake going on
+  std::string handshake_replies_;
+  std::string handshake_error_;
 
   on_stream_closed_cb on_stream_closed_cb_;
   on_reconnect_cb on_reconnect_cb_;
@@ -120,9 +588,25 @@ private:
   std::string original_host_;
   std::string original_port_;
 
+  // the addresses the host resolved to, reused for resolve_ttl_
+  std::vector<asio_stream::endpoint_type> endpoints_;
+  std::string resolved_host_;
+  std::string resolved_port_;
+  std::chrono::steady_clock::time_point resolved_at_;
+  std::chrono::steady_clock::duration resolve_ttl_;
+
+  std::vector<std::shared_ptr<standby>> standby_;
+  size_t standby_count_;
+  // waits before opening spare connections again after a failure
+  boost::asio::steady_timer standby_timer_;
+
   // is_closed is used to avoid reconnecting because the client closes on
   // purpose.
   bool is_closed_;
+  // set from the first error until the connection is back
+  bool is_reconnecting_;
+  // expires with the stream, see io_op
+  std::shared_ptr<void> lifetime_;
 };
 
 }  // namespace redis
@@ -0,0 +1,325 @@
+#ifndef REDIS_BULK_LOADER_H
+#define REDIS_BULK_LOADER_H
+
+#include <redis/basic_stream.hpp>
+#include <redis/types.hpp>
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#ifndef DEFAULT_BULK_CHUNK_SIZE
+#define DEFAULT_BULK_CHUNK_SIZE (1024 * 1024)
+#endif
+
+#ifndef DEFAULT_BULK_READ_SIZE
+#define DEFAULT_BULK_READ_SIZE 65536
+#endif
+
+// a loaded file whose next command doesn't end within this many bytes is
+// rejected, as Redis does with proto-max-bulk-len
+#ifndef DEFAULT_BULK_MAX_COMMAND_SIZE
+#define DEFAULT_BULK_MAX_COMMAND_SIZE (512 * 1024 * 1024)
+#endif
+
+namespace redis
+{
+/**
+ * bulk_loader pushes large amounts of already encoded commands through its
+ *own connection, much like `redis-cli --pipe`.
+ *
+ * Commands are written back to back in large chunks, the next chunk being
+ *filled while the previous one is written. Replies are only counted and
+ *skipped, errors being the only ones reported.
+ **/
+class bulk_loader
+{
+public:
+  /**
+   * How the replies of the loaded commands are handled.
+   **/
+  enum reply_mode
+  {
+    // every reply is read and the errors reported
+    count,
+    // the server is told not to reply (CLIENT REPLY OFF), errors are lost
+    off
+  };
+
+  struct result
+  {
+    // commands sent
+    size_t commands;
+    // commands that failed. Always 0 with `reply_mode::off`
+    size_t errors;
+  };
+
+  /**
+   * Appends whole encoded commands to `out`, stopping around `max_bytes`.
+   *Returns the number of commands appended, 0 once there are no more.
+   **/
+  using source = std::function<size_t(std::string& out, size_t max_bytes)>;
+
+  using error_cb = std::function<void(size_t, const redis::types::error&)>;
+  using done_cb =
+      std::function<void(boost::system::error_code, const result&)>;
+
+public:
+  bulk_loader()              = delete;
+  bulk_loader(bulk_loader&)  = delete;
+  bulk_loader(bulk_loader&&) = delete;
+
+  /**
+   * Should always be initialised with the io_context.
+   **/
+  bulk_loader(boost::asio::io_context& ioc);
+
+  /**
+   * Returns the io_context passed on the constructor.
+   **/
+  basic_stream::asio_stream::executor_type get_executor();
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * Note that this function will throw an exception if any
+   *boost::system::error_code error is encountered.
+   *
+   * @param hostport Should be a valid host and port in the following format
+   * `host:port`, or the path of a unix domain socket as `unix:///path`.
+   **/
+  void connect(const std::string& hostport);
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * This function will not throw any exception.
+   *
+   * @param hostport Should be a valid host and port in the following format
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
+   * @param ec Is a valid reference to a boost::system::error_code that will be
+   *set by the function if any error happens.
+   **/
+  void connect(const std::string& hostport,
+               boost::system::error_code& ec) noexcept;
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * Note that this function will throw an exception if any
+   *boost::system::error_code error is encountered.
+   *
+   * @param host Is a valid hostname or IP.
+   * @param port Is a valid port as a string.
+   **/
+  void connect(const std::string& host, const std::string& port);
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * @param host Is a valid hostname or IP.
+   * @param port Is a valid port as a string.
+   * @param ec Is a valid reference to a boost::system::error_code that will be
+   *set by the function if any error happens.
+   **/
+  void connect(const std::string& host, const std::string& port,
+               boost::system::error_code& ec) noexcept;
+
+  /**
+   * Makes the connections use TLS, with the session resumed on every
+   *reconnection. Must be called before connecting.
+   *
+   * @param ctx Is the context the connections are made with. It must
+   *outlive the stream.
+   * @param options Are the server name, ciphers and ALPN protocols.
+   **/
+  void set_tls(boost::asio::ssl::context& ctx,
+               tls_options options = {})
+  {
+    stream_.set_tls(ctx, std::move(options));
+  }
+
+  /**
+   * Sets the commands sent first on every connection, the reconnections
+   *included, e.g. AUTH and SELECT. No command of the load is written before
+   *they all succeeded. A reply with an error fails the connection with
+   *redis::errc::handshake_failed, see basic_stream::set_handshake.
+   *
+   * @param options Are the credentials, client name, database and other
+   *commands to send.
+   **/
+  void set_handshake(handshake_options options)
+  {
+    stream_.set_handshake(std::move(options));
+  }
+
+  /**
+   * Returns the error the server replied to the last handshake, empty if it
+   *succeeded.
+   **/
+  const std::string& handshake_error() const
+  {
+    return stream_.handshake_error();
+  }
+
+  /**
+   * Establishes a connection to a redis instance asynchronously.
+   *
+   * This function will return immediately.
+   *
+   * @param hostport Should be a valid host and port in the following format
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
+   * @param cb Is the callback that will get called when the operation ends.
+   **/
+  void async_connect(const std::string& hostport,
+                     basic_stream::on_connect_cb cb) noexcept;
+
+  /**
+   * Establishes a connection to a redis instance asynchronously.
+   *
+   * This function will return immediately.
+   *
+   * @param host Is a valid hostname or IP.
+   * @param port Is a valid port as a string.
+   * @param cb Is the callback that will get called when the operation ends.
+   **/
+  void async_connect(const std::string& host, const std::string& port,
+                     basic_stream::on_connect_cb cb) noexcept;
+
+  /**
+   * Sets roughly how many bytes are written at once. Defaults to
+   *DEFAULT_BULK_CHUNK_SIZE.
+   **/
+  void set_chunk_size(size_t bytes)
+  {
+    chunk_size_ = bytes;
+  }
+
+  /**
+   * Sets how replies are handled. Defaults to `reply_mode::count`.
+   **/
+  void set_reply_mode(reply_mode mode)
+  {
+    reply_mode_ = mode;
+  }
+
+  /**
+   * Sets a callback for the commands that failed.
+   *
+   * The callback gets the position of the command in the load (starting at
+   *0) and the error returned by the server.
+   **/
+  void set_on_error(error_cb cb)
+  {
+    on_error_cb_ = cb;
+  }
+
+  /**
+   * Loads the commands produced by `src`. Only one load can run at a time.
+   *
+   * @param src Is the source of the commands.
+   * @param cb Is the callback that will get called once every reply has
+   *been received or the connection failed.
+   **/
+  void async_load(source src, done_cb cb);
+
+  /**
+   * Loads the commands of a range. Every element must be a whole encoded
+   *command convertible to std::string_view, and the range must stay valid
+   *until `cb` is called.
+   *
+   * @param first Is the first command.
+   * @param last Is the end of the range.
+   * @param cb Is the callback that will get called once every reply has
+   *been received or the connection failed.
+   **/
+  template<class Iterator>
+  void async_load(Iterator first, Iterator last, done_cb cb)
+  {
+    async_load(
+        [first, last](std::string& out, size_t max_bytes) mutable -> size_t
+        {
+          size_t commands = 0;
+          for (; first != last && out.size() < max_bytes; ++first)
+          {
+            out.append(std::string_view(*first));
+            commands++;
+          }
+
+          return commands;
+        },
+        cb);
+  }
+
+  /**
+   * Loads a file of RESP encoded commands, as the ones used with
+   *`redis-cli --pipe`.
+   *
+   * The file is read in chunks on the thread running the io_context.
+   *
+   * @param path Is the path of the file.
+   * @param cb Is the callback that will get called once every reply has
+   *been received or the connection failed. The file not being readable is
+   *reported as `boost::system::errc::no_such_file_or_directory`. A file
+   *that isn't RESP, or whose last command is cut short, is reported as
+   *`redis::errc::malformed_command` once the commands before it are loaded.
+   **/
+  void async_load_file(const std::string& path, done_cb cb);
+
+  /**
+   * Returns whether the socket is open or not.
+   **/
+  operator bool()
+  {
+    return !!stream_;
+  }
+
+  /**
+   * Closes the connection and the underlying socket.
+   **/
+  inline void close()
+  {
+    stream_.close();
+  }
+
+private:
+  void fill();
+
+  void write();
+  void read();
+  void on_read(boost::system::error_code const& ec, size_t read_bytes);
+
+  void finish(boost::system::error_code ec);
+
+private:
+  redis::basic_stream stream_;
+
+  size_t chunk_size_;
+  reply_mode reply_mode_;
+
+  error_cb on_error_cb_;
+  done_cb on_done_cb_;
+
+  source source_;
+  bool is_exhausted_;
+  // why the source stopped early, reported once the load completes
+  boost::system::error_code source_error_;
+
+  // commands sent and replies expected and received
+  result result_;
+  size_t expected_;
+  size_t received_;
+
+  // next chunk, filled while sending_buffer_ is written
+  std::string write_buffer_;
+  std::string sending_buffer_;
+  boost::asio::streambuf read_buffer_;
+
+  bool is_running_;
+  bool is_reading_;
+  bool is_writing_;
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef REDIS_BYTE_SCAN_H
+#define REDIS_BYTE_SCAN_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define REDIS_SCAN_X86 1
+#endif
+
+namespace redis
+{
+/**
+ * Byte scanning used by the parsers.
+ *
+ * On x86-64 the scans are vectorized with SSE2, or AVX2 when the CPU supports
+ *it, chosen once at runtime. Other targets use a scalar loop.
+ **/
+
+/**
+ * Returns the position of the first CRLF of [s, s + n), or n if there is
+ *none.
+ **/
+size_t find_crlf(const char* s, size_t n);
+
+/**
+ * Returns the position of the first RESP type prefix (one of + - : $ *) of
+ *[s, s + n), or n if there is none.
+ **/
+size_t find_prefix(const char* s, size_t n);
+
+#ifdef REDIS_SCAN_X86
+namespace detail
+{
+// the implementations find_crlf and find_prefix choose from, so each can be
+// tested whatever the CPU picks. The AVX2 ones need has_avx2().
+size_t find_crlf_sse2(const char* s, size_t n);
+size_t find_crlf_avx2(const char* s, size_t n);
+size_t find_prefix_sse2(const char* s, size_t n);
+size_t find_prefix_avx2(const char* s, size_t n);
+
+bool has_avx2();
+}  // namespace detail
+#endif
+}  // namespace redis
+
+#endif
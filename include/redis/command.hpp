@@ -0,0 +1,104 @@
+#ifndef REDIS_COMMAND_H
+#define REDIS_COMMAND_H
+
+#include <redis/arg_traits.hpp>
+
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace redis
+{
+/**
+ * command is a command already encoded in RESP, ready to be sent.
+ *
+ * Encoding once and sending the same command several times avoids
+ *serializing the arguments again on every call.
+ **/
+class command
+{
+public:
+  /**
+   * @param args Are the command and arguments. For example: "SET", "key",
+   *"value". The parameters can be any type with a redis::arg_traits.
+   **/
+  template<class... Args,
+           typename = std::enable_if_t<!(
+               sizeof...(Args) == 1 &&
+               (std::is_same_v<std::decay_t<Args>, command> && ...))>>
+  explicit command(const Args&... args)
+  {
+    encode(buffer_, args...);
+  }
+
+  /**
+   * @param args Are the command and arguments only known at runtime.
+   **/
+  explicit command(const std::vector<std::string>& args)
+  {
+    encode(buffer_, args);
+  }
+
+  /**
+   * Returns the encoded command.
+   **/
+  const std::string& data() const
+  {
+    return buffer_;
+  }
+
+  /**
+   * Appends a command to `out` as a RESP array of bulk strings.
+   *
+   * Every argument is serialized by its redis::arg_traits.
+   **/
+  template<class... Args>
+  static void encode(std::string& out, const Args&... args)
+  {
+    static_assert((is_arg<std::decay_t<Args>>::value && ...),
+                  "an argument has no redis::arg_traits, e.g. a bool");
+
+    size_t count =
+        (size_t(0) + ... + arg_traits<std::decay_t<Args>>::count(args));
+
+    // send as array
+    out += '*';
+    out += std::to_string(count);
+    out += "\r\n";
+
+    (arg_traits<std::decay_t<Args>>::write(out, args), ...);
+  }
+
+  /**
+   * Appends a command whose arguments are only known at runtime to `out`.
+   **/
+  static void encode(std::string& out, const std::vector<std::string>& args)
+  {
+    out += '*';
+    out += std::to_string(args.size());
+    out += "\r\n";
+
+    for (auto&& arg : args)
+      write_bulk(out, arg);
+  }
+
+private:
+  std::string buffer_;
+};
+
+/**
+ * typed_command is a command whose reply is decoded into a `T` instead of an
+ *any_type. `T` can be any type with a redis::reply_decoder.
+ **/
+template<class T>
+class typed_command : public command
+{
+public:
+  using reply_type = T;
+
+  using command::command;
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef REDIS_COMMANDS_H
+#define REDIS_COMMANDS_H
+
+#include <redis/command.hpp>
+#include <redis/reply_decoder.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Typed builders for the most common commands.
+ *
+ * Every builder returns a typed_command with the natural reply type of the
+ *command. The reply type can be changed through the template parameter,
+ *e.g. `cmd::get<int64_t>("counter")`.
+ *
+ * Commands without a builder can be typed directly:
+ *`typed_command<int64_t>("SCARD", "key")`.
+ **/
+namespace redis::cmd
+{
+template<class T = std::string>
+typed_command<T> ping()
+{
+  return typed_command<T>("PING");
+}
+
+template<class T = std::optional<std::string>>
+typed_command<T> get(const std::string& key)
+{
+  return typed_command<T>("GET", key);
+}
+
+/**
+ * @param options Are the optional arguments, e.g. "EX", 10 or "NX". The
+ *reply is false when NX or XX prevent the write.
+ **/
+template<class T = bool, class... Args>
+typed_command<T> set(const std::string& key, const std::string& value,
+                     Args... options)
+{
+  return typed_command<T>("SET", key, value, options...);
+}
+
+template<class T = std::vector<std::optional<std::string>>>
+typed_command<T> mget(const std::vector<std::string>& keys)
+{
+  std::vector<std::string> args{"MGET"};
+  args.insert(args.end(), keys.begin(), keys.end());
+
+  return typed_command<T>(args);
+}
+
+/**
+ * @param pairs Is a range of key and value pairs, e.g. a std::map.
+ **/
+template<class T = bool, class Pairs>
+typed_command<T> mset(const Pairs& pairs)
+{
+  return typed_command<T>("MSET", pairs);
+}
+
+template<class T = int64_t>
+typed_command<T> del(const std::string& key)
+{
+  return typed_command<T>("DEL", key);
+}
+
+template<class T = bool>
+typed_command<T> exists(const std::string& key)
+{
+  return typed_command<T>("EXISTS", key);
+}
+
+template<class T = bool>
+typed_command<T> expire(const std::string& key, int64_t seconds)
+{
+  return typed_command<T>("EXPIRE", key, seconds);
+}
+
+template<class T = int64_t>
+typed_command<T> ttl(const std::string& key)
+{
+  return typed_command<T>("TTL", key);
+}
+
+template<class T = int64_t>
+typed_command<T> incr(const std::string& key)
+{
+  return typed_command<T>("INCR", key);
+}
+
+template<class T = int64_t>
+typed_command<T> incrby(const std::string& key, int64_t increment)
+{
+  return typed_command<T>("INCRBY", key, increment);
+}
+
+template<class T = double>
+typed_command<T> incrbyfloat(const std::string& key, double increment)
+{
+  return typed_command<T>("INCRBYFLOAT", key, increment);
+}
+
+template<class T = int64_t>
+typed_command<T> decr(const std::string& key)
+{
+  return typed_command<T>("DECR", key);
+}
+
+template<class T = std::optional<std::string>>
+typed_command<T> hget(const std::string& key, const std::string& field)
+{
+  return typed_command<T>("HGET", key, field);
+}
+
+template<class T = int64_t>
+typed_command<T> hset(const std::string& key, const std::string& field,
+                      const std::string& value)
+{
+  return typed_command<T>("HSET", key, field, value);
+}
+
+/**
+ * @param fields Is a range of field and value pairs, e.g. a std::map.
+ **/
+template<class T = int64_t, class Fields>
+typed_command<T> hset(const std::string& key, const Fields& fields)
+{
+  return typed_command<T>("HSET", key, fields);
+}
+
+template<class T = int64_t>
+typed_command<T> hdel(const std::string& key, const std::string& field)
+{
+  return typed_command<T>("HDEL", key, field);
+}
+
+template<class T = boost::container::flat_map<std::string, std::string>>
+typed_command<T> hgetall(const std::string& key)
+{
+  return typed_command<T>("HGETALL", key);
+}
+
+template<class T = int64_t>
+typed_command<T> hincrby(const std::string& key, const std::string& field,
+                         int64_t increment)
+{
+  return typed_command<T>("HINCRBY", key, field, increment);
+}
+
+template<class T = int64_t>
+typed_command<T> lpush(const std::string& key, const std::string& value)
+{
+  return typed_command<T>("LPUSH", key, value);
+}
+
+template<class T = int64_t>
+typed_command<T> rpush(const std::string& key, const std::string& value)
+{
+  return typed_command<T>("RPUSH", key, value);
+}
+
+template<class T = std::optional<std::string>>
+typed_command<T> lpop(const std::string& key)
+{
+  return typed_command<T>("LPOP", key);
+}
+
+template<class T = std::vector<std::string>>
+typed_command<T> lrange(const std::string& key, int64_t start, int64_t stop)
+{
+  return typed_command<T>("LRANGE", key, start, stop);
+}
+
+template<class T = int64_t>
+typed_command<T> sadd(const std::string& key, const std::string& member)
+{
+  return typed_command<T>("SADD", key, member);
+}
+
+template<class T = std::vector<std::string>>
+typed_command<T> smembers(const std::string& key)
+{
+  return typed_command<T>("SMEMBERS", key);
+}
+
+template<class T = bool>
+typed_command<T> sismember(const std::string& key, const std::string& member)
+{
+  return typed_command<T>("SISMEMBER", key, member);
+}
+
+template<class T = int64_t>
+typed_command<T> zadd(const std::string& key, double score,
+                      const std::string& member)
+{
+  return typed_command<T>("ZADD", key, score, member);
+}
+
+/**
+ * @param members Is a range of score and member pairs, e.g. a
+ *std::vector<std::pair<double, std::string>>.
+ **/
+template<class T = int64_t, class Members>
+typed_command<T> zadd(const std::string& key, const Members& members)
+{
+  return typed_command<T>("ZADD", key, members);
+}
+
+template<class T = double>
+typed_command<T> zincrby(const std::string& key, double increment,
+                         const std::string& member)
+{
+  return typed_command<T>("ZINCRBY", key, increment, member);
+}
+
+template<class T = std::optional<double>>
+typed_command<T> zscore(const std::string& key, const std::string& member)
+{
+  return typed_command<T>("ZSCORE", key, member);
+}
+
+/**
+ * ZRANGE with WITHSCORES, the members in order with their scores.
+ **/
+template<class T = std::vector<std::pair<std::string, double>>>
+typed_command<T> zrange_withscores(const std::string& key, int64_t start,
+                                   int64_t stop)
+{
+  return typed_command<T>("ZRANGE", key, start, stop, "WITHSCORES");
+}
+
+/**
+ * @param unit Is one of m, km, ft or mi. The reply is nil if a member is
+ *missing.
+ **/
+template<class T = std::optional<double>>
+typed_command<T> geodist(const std::string& key, const std::string& member1,
+                         const std::string& member2,
+                         const std::string& unit = "m")
+{
+  return typed_command<T>("GEODIST", key, member1, member2, unit);
+}
+}  // namespace redis::cmd
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef REDIS_COMPLETION_H
+#define REDIS_COMPLETION_H
+
+#include <boost/asio.hpp>
+
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace redis
+{
+/**
+ * bound_handler invokes a handler with the arguments bound to it, for
+ *dispatching a completion. Unlike a lambda it keeps the associated allocator
+ *of the handler, so the dispatch allocates the way the handler asks.
+ **/
+template<class Handler, class Invoker>
+struct bound_handler
+{
+  using allocator_type = boost::asio::associated_allocator_t<Handler>;
+
+  Handler handler;
+  // called with the handler, e.g. std::apply on the arguments
+  Invoker invoker;
+
+  allocator_type get_allocator() const noexcept
+  {
+    return boost::asio::get_associated_allocator(handler);
+  }
+
+  void operator()()
+  {
+    std::move(invoker)(handler);
+  }
+};
+
+template<class Handler, class Invoker>
+bound_handler<std::decay_t<Handler>, std::decay_t<Invoker>> bind_handler(
+    Handler&& handler, Invoker&& invoker)
+{
+  return {std::forward<Handler>(handler), std::forward<Invoker>(invoker)};
+}
+
+/**
+ * completion holds the handler of an asynchronous operation, its type
+ *erased, for the helpers completing many operations from a single reply.
+ *The handler is invoked on its associated executor.
+ **/
+template<class... Args>
+class completion
+{
+public:
+  virtual ~completion() = default;
+
+  /**
+   * Invokes the handler with `args`, only once.
+   **/
+  virtual void complete(Args... args) = 0;
+
+  /**
+   * @param handler Is the handler to hold.
+   * @param ex Is the executor used if the handler has none associated.
+   **/
+  template<class Handler, class Executor>
+  static std::unique_ptr<completion> make(Handler&& handler,
+                                          const Executor& ex);
+
+private:
+  template<class Handler, class Executor>
+  class impl;
+};
+
+template<class... Args>
+template<class Handler, class Executor>
+class completion<Args...>::impl final : public completion<Args...>
+{
+public:
+  using executor_type =
+      typename boost::asio::associated_executor<Handler, Executor>::type;
+
+  template<class H>
+  impl(H&& h, const Executor& ex)
+      : handler_(std::forward<H>(h))
+      , work_(boost::asio::get_associated_executor(handler_, ex))
+  {
+  }
+
+  void complete(Args... args) override
+  {
+    auto w(std::move(work_));
+
+    boost::asio::dispatch(
+        w.get_executor(),
+        bind_handler(std::move(handler_),
+                     [args = std::make_tuple(std::move(args)...)](
+                         Handler& h) mutable
+                     { std::apply(std::move(h), std::move(args)); }));
+  }
+
+private:
+  Handler handler_;
+  boost::asio::executor_work_guard<executor_type> work_;
+};
+
+template<class... Args>
+template<class Handler, class Executor>
+std::unique_ptr<completion<Args...>> completion<Args...>::make(
+    Handler&& handler, const Executor& ex)
+{
+  return std::make_unique<impl<std::decay_t<Handler>, Executor>>(
+      std::forward<Handler>(handler), ex);
+}
+}  // namespace redis
+
+#endif
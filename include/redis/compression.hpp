@@ -0,0 +1,209 @@
+#ifndef REDIS_COMPRESSION_H
+#define REDIS_COMPRESSION_H
+
+#include <redis/arg_traits.hpp>
+#include <redis/completion.hpp>
+#include <redis/error.hpp>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifndef DEFAULT_COMPRESSION_THRESHOLD
+#define DEFAULT_COMPRESSION_THRESHOLD 4096
+#endif
+
+#ifndef DEFAULT_DECOMPRESSION_OFFLOAD_SIZE
+#define DEFAULT_DECOMPRESSION_OFFLOAD_SIZE 65536
+#endif
+
+namespace redis
+{
+/**
+ * A compression algorithm, e.g. redis::lz4_codec when built with
+ *REDIS_CLIENT_LZ4.
+ **/
+class codec
+{
+public:
+  virtual ~codec() = default;
+
+  /**
+   * Returns the byte stored in the header of the values compressed with
+   *this codec. 0 is reserved for values stored as they are.
+   **/
+  virtual uint8_t id() const = 0;
+
+  /**
+   * Appends `in` compressed to `out`. Returns false if it can't.
+   **/
+  virtual bool compress(std::string_view in, std::string& out) const = 0;
+
+  /**
+   * Appends the `size` bytes `in` decompresses to to `out`. Returns false
+   *if `in` is corrupt.
+   **/
+  virtual bool decompress(std::string_view in, size_t size,
+                          std::string& out) const = 0;
+};
+
+/**
+ * compression stores values of at least a threshold size compressed, behind
+ *an 8 byte header with a magic number, the codec id and the original size.
+ *Smaller values are stored as they are, as are values the codec can't
+ *shrink.
+ *
+ * Values are compressed when passed through the call operator to a command:
+ *
+ *   redis.async_write(cb, "SET", "key", compression(value));
+ *
+ * and decompressed from the stored bytes with `decompress` or, for large
+ *values, with `async_decompress`, which does it on a thread of its own.
+ *Values that don't start with the header are returned as they are, so
+ *compression can be enabled on existing data.
+ *
+ * Replies aren't decompressed as they are read: the typed commands decode
+ *on the event loop, where a large value would hold up every other reply,
+ *and the codecs belong to a compression object rather than to the reply
+ *type. The reply is read as the stored bytes and handed to one of the
+ *functions above.
+ **/
+class compression
+{
+public:
+  // a value to compress as it is written into a command
+  struct arg
+  {
+    const compression& c;
+    std::string_view value;
+  };
+
+  static constexpr size_t header_size = 8;
+
+public:
+  compression(compression&)  = delete;
+  compression(compression&&) = delete;
+
+  /**
+   * @param c Is the codec values are compressed with.
+   * @param threshold Is the size from which values are compressed.
+   * @param threads Is the number of threads of `async_decompress`.
+   **/
+  explicit compression(std::shared_ptr<const codec> c,
+                       size_t threshold = DEFAULT_COMPRESSION_THRESHOLD,
+                       size_t threads   = 1);
+
+  ~compression();
+
+  /**
+   * Adds a codec only used to decompress, e.g. the one used before
+   *switching to a new codec.
+   **/
+  void add(std::shared_ptr<const codec> c);
+
+  arg operator()(std::string_view value) const
+  {
+    return {*this, value};
+  }
+
+  /**
+   * Appends `value` to `out` as it is stored.
+   *
+   * Throws std::length_error if the value is longer than max_size, the
+   *size the header can hold.
+   **/
+  void compress(std::string_view value, std::string& out) const;
+
+  /**
+   * Appends the original value of `stored` to `out`. Returns false if the
+   *codec is unknown or the value corrupt.
+   **/
+  bool decompress(std::string_view stored, std::string& out) const;
+
+  /**
+   * Returns whether `stored` starts with the compression header.
+   **/
+  static bool is_compressed(std::string_view stored);
+
+  // the longest value the header can describe
+  static constexpr size_t max_size = UINT32_MAX;
+
+  /**
+   * Decompresses `stored` and completes with void(error_code, std::string).
+   *Values of DEFAULT_DECOMPRESSION_OFFLOAD_SIZE bytes or more are
+   *decompressed on the threads of this object, so the event loop reading
+   *the replies isn't held up by them.
+   *
+   * @param ex Is the executor the handler is invoked on if it has none
+   *associated, e.g. `redis.get_executor()`.
+   * @param stored Is the value as stored.
+   **/
+  template<class Executor, class CompletionToken>
+  auto async_decompress(const Executor& ex, std::string stored,
+                        CompletionToken&& token)
+  {
+    return boost::asio::async_initiate<
+        CompletionToken, void(boost::system::error_code, std::string)>(
+        [this, &ex](auto&& handler, std::string stored)
+        {
+          // keeps the executor busy until the handler is queued, or an idle
+          // io_context would stop
+          std::shared_ptr<waiter_type> waiter = waiter_type::make(
+              std::forward<decltype(handler)>(handler), ex);
+          bool offload = stored.size() >= DEFAULT_DECOMPRESSION_OFFLOAD_SIZE;
+
+          auto run = [this, stored = std::move(stored), waiter]()
+          {
+            std::string value;
+            boost::system::error_code ec;
+            if (!decompress(stored, value))
+              ec = errc::decompression_failed;
+
+            waiter->complete(ec, std::move(value));
+          };
+
+          if (offload)
+            boost::asio::post(pool_, std::move(run));
+          else
+            run();
+        },
+        token, std::move(stored));
+  }
+
+private:
+  using waiter_type = completion<boost::system::error_code, std::string>;
+
+  const codec* find(uint8_t id) const;
+
+private:
+  std::shared_ptr<const codec> codec_;
+  // every codec that can decompress, codec_ included
+  std::vector<std::shared_ptr<const codec>> codecs_;
+  size_t threshold_;
+  boost::asio::thread_pool pool_;
+};
+
+template<>
+struct arg_traits<compression::arg>
+{
+  static size_t count(const compression::arg&)
+  {
+    return 1;
+  }
+
+  static void write(std::string& out, const compression::arg& a)
+  {
+    std::string stored;
+    a.c.compress(a.value, stored);
+    write_bulk(out, stored);
+  }
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef REDIS_ERROR_H
+#define REDIS_ERROR_H
+
+#include <boost/system/error_code.hpp>
+#include <type_traits>
+
+namespace redis
+{
+/**
+ * Errors reported by the typed commands, the compression layer and the
+ *command deadlines.
+ **/
+enum class errc
+{
+  // the connection was lost before the reply arrived
+  connection_lost = 1,
+  // the server replied with an error
+  server_error,
+  // the server replied with WRONGTYPE
+  wrong_type,
+  // the server replied with NOSCRIPT
+  no_script,
+  // the reply can't be decoded into the requested type
+  unexpected_reply,
+  // a compressed value is corrupt or its codec unknown
+  decompression_failed,
+  // the reply didn't arrive before the deadline of the command
+  timeout,
+  // the server replied with an error to a command of the handshake
+  handshake_failed,
+  // a file of commands to load isn't RESP or ends in the middle of one
+  malformed_command
+};
+
+const boost::system::error_category& error_category() noexcept;
+
+inline boost::system::error_code make_error_code(errc e) noexcept
+{
+  return {static_cast<int>(e), error_category()};
+}
+}  // namespace redis
+
+namespace boost::system
+{
+template<>
+struct is_error_code_enum<redis::errc> : std::true_type
+{
+};
+}  // namespace boost::system
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef REDIS_LZ4_CODEC_H
+#define REDIS_LZ4_CODEC_H
+
+#include <redis/compression.hpp>
+
+namespace redis
+{
+/**
+ * LZ4 block compression. Only available when built with REDIS_CLIENT_LZ4.
+ **/
+class lz4_codec : public codec
+{
+public:
+  /**
+   * @param acceleration Trades compression ratio for speed, 1 is the
+   *default of LZ4.
+   **/
+  explicit lz4_codec(int acceleration = 1);
+
+  uint8_t id() const override;
+
+  bool compress(std::string_view in, std::string& out) const override;
+
+  bool decompress(std::string_view in, size_t size,
+                  std::string& out) const override;
+
+private:
+  int acceleration_;
+};
+}  // namespace redis
+
+#endif
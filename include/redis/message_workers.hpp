@@ -0,0 +1,109 @@
+#ifndef REDIS_MESSAGE_WORKERS_H
+#define REDIS_MESSAGE_WORKERS_H
+
+#include <redis/spsc_queue.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef DEFAULT_WORKER_QUEUE_SIZE
+#define DEFAULT_WORKER_QUEUE_SIZE 4096
+#endif
+
+namespace redis
+{
+/**
+ * message_workers runs pub/sub callbacks on a fixed set of worker threads.
+ *
+ * Every worker owns a spsc_queue fed by the thread running the io_context,
+ * so messages dispatched to the same worker are handled in order. Workers
+ * spin briefly when their queue runs dry and then park until the producer
+ * wakes them up.
+ **/
+class message_workers
+{
+public:
+  using message_cb = std::function<void(std::string, std::string)>;
+
+public:
+  message_workers()                  = delete;
+  message_workers(message_workers&)  = delete;
+  message_workers(message_workers&&) = delete;
+
+  /**
+   * Starts `threads` workers.
+   *
+   * @param threads Is the number of worker threads. Must be greater than 0.
+   * @param queue_size Is the capacity of each worker's queue.
+   **/
+  message_workers(size_t threads, size_t queue_size);
+
+  /**
+   * Handles every message already queued and joins the worker threads.
+   **/
+  ~message_workers();
+
+  /**
+   * Hands a message over to a worker. Must always be called from the same
+   * thread.
+   *
+   * If the worker's queue is full the calling thread yields until there is
+   * room, which stops reading from the socket until the workers catch up.
+   *
+   * @param worker Is the index of the worker, taken modulo `size()`.
+   * @param cb Is the callback the worker will invoke.
+   * @param channel Is the channel the message was published on.
+   * @param message Is the message payload.
+   **/
+  void dispatch(size_t worker, const std::shared_ptr<const message_cb>& cb,
+                std::string&& channel, std::string&& message);
+
+  /**
+   * Returns the number of worker threads.
+   **/
+  size_t size() const
+  {
+    return workers_.size();
+  }
+
+private:
+  struct message
+  {
+    std::shared_ptr<const message_cb> cb;
+    std::string channel;
+    std::string message;
+  };
+
+  struct worker
+  {
+    worker(size_t queue_size)
+        : queue(queue_size)
+        , sleeping(false)
+    {
+    }
+
+    spsc_queue<message> queue;
+
+    // only used to park the thread when the queue is empty
+    std::atomic<bool> sleeping;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::thread thread;
+  };
+
+  void run(worker& w);
+
+private:
+  std::vector<std::unique_ptr<worker>> workers_;
+  std::atomic<bool> stopped_;
+};
+}  // namespace redis
+
+#endif
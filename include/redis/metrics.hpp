@@ -0,0 +1,171 @@
+#ifndef REDIS_METRICS_H
+#define REDIS_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// distinct command names with a histogram of their own, the others are
+// recorded as OTHER
+#ifndef DEFAULT_METRICS_COMMANDS
+#define DEFAULT_METRICS_COMMANDS 128
+#endif
+
+namespace redis
+{
+/**
+ * latency_histogram records durations in log-linear buckets, HDR histogram
+ *style: 16 buckets per power of two nanoseconds, so any value is known
+ *within 6.25% up to hours. Recording is lock-free and can happen from any
+ *number of threads while it is read.
+ **/
+class latency_histogram
+{
+public:
+  static constexpr size_t sub_buckets  = 16;
+  static constexpr size_t bucket_count = (64 - 4 + 1) * sub_buckets;
+
+  struct snapshot
+  {
+    uint64_t count = 0;
+    // nanoseconds
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+
+    /**
+     * Returns the duration `q` of the values are below or equal to, e.g.
+     *0.99 for the p99. The value returned is the upper bound of its bucket.
+     **/
+    std::chrono::nanoseconds percentile(double q) const;
+  };
+
+public:
+  latency_histogram();
+
+  void record(std::chrono::nanoseconds d) noexcept;
+
+  snapshot get() const;
+
+  /**
+   * Returns the bucket of a value in nanoseconds.
+   **/
+  static size_t bucket(uint64_t ns) noexcept;
+
+  /**
+   * Returns the largest value in nanoseconds falling in bucket `i`.
+   **/
+  static uint64_t upper_bound(size_t i) noexcept;
+
+private:
+  std::array<std::atomic<uint64_t>, bucket_count> buckets_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
+/**
+ * metrics collects what the streams it is set on do, see
+ *stream::set_metrics. It can be shared by several streams, e.g. a pool, and
+ *read from any thread while they run.
+ *
+ * Each command is timed from the call to async_write to its reply being
+ *dispatched, in a histogram per command name. The time commands wait to be
+ *written to the socket is recorded apart, telling the time queued behind
+ *other commands from the time the server takes.
+ **/
+class metrics
+{
+public:
+  // the histogram of a command name
+  struct command_metrics
+  {
+    std::string name;
+    latency_histogram latency;
+  };
+
+  struct snapshot
+  {
+    // commands sent with async_write or async_exec
+    uint64_t commands;
+    // replies dispatched, errors included
+    uint64_t replies;
+    // error replies
+    uint64_t errors;
+    // commands whose reply was lost with the connection
+    uint64_t lost;
+    // commands whose reply didn't arrive before their deadline
+    uint64_t timeouts;
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    // connections established, the reconnections included
+    uint64_t connections;
+    uint64_t disconnections;
+
+    // commands waiting to be written
+    int64_t queued;
+    // commands written waiting for their reply
+    int64_t in_flight;
+
+    // time from async_write to the socket write
+    latency_histogram::snapshot queue_time;
+    // time from async_write to the reply, per command name
+    std::vector<std::pair<std::string, latency_histogram::snapshot>> latency;
+  };
+
+public:
+  metrics();
+  ~metrics();
+
+  metrics(metrics&)  = delete;
+  metrics(metrics&&) = delete;
+
+  /**
+   * Returns the histogram of a command, creating it the first time. Names
+   *are upper cased, those longer than 32 bytes are recorded as OTHER.
+   **/
+  command_metrics& command(std::string_view name);
+
+  /**
+   * Returns the current values.
+   **/
+  snapshot get() const;
+
+  /**
+   * Appends the current values in the Prometheus text format. The latency
+   *histograms are exported with buckets from 100us to 10s.
+   *
+   * @param prefix Starts the name of every metric.
+   **/
+  void write_prometheus(std::string& out,
+                        std::string_view prefix = "redis_client") const;
+
+public:
+  std::atomic<uint64_t> commands;
+  std::atomic<uint64_t> replies;
+  std::atomic<uint64_t> errors;
+  std::atomic<uint64_t> lost;
+  std::atomic<uint64_t> timeouts;
+  std::atomic<uint64_t> bytes_written;
+  std::atomic<uint64_t> bytes_read;
+  std::atomic<uint64_t> connections;
+  std::atomic<uint64_t> disconnections;
+
+  std::atomic<int64_t> queued;
+  std::atomic<int64_t> in_flight;
+
+  latency_histogram queue_time;
+
+private:
+  // open addressing on the name, entries are only ever added
+  std::array<std::atomic<command_metrics*>, DEFAULT_METRICS_COMMANDS>
+      commands_;
+  command_metrics other_;
+};
+}  // namespace redis
+
+#endif
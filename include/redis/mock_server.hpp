@@ -0,0 +1,206 @@
+#ifndef REDIS_MOCK_SERVER_H
+#define REDIS_MOCK_SERVER_H
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef DEFAULT_MOCK_READ_SIZE
+#define DEFAULT_MOCK_READ_SIZE 65536
+#endif
+
+// pub/sub floods stop filling a subscriber's output past this many bytes
+// until it has been written
+#ifndef DEFAULT_MOCK_FLOOD_BACKLOG
+#define DEFAULT_MOCK_FLOOD_BACKLOG (1024 * 1024)
+#endif
+
+namespace redis
+{
+/**
+ * mock_server is an in-process RESP server for tests and benchmarks, running
+ *on a thread of its own and listening on 127.0.0.1 on a port picked by the
+ *system.
+ *
+ * Out of the box it answers PING, ECHO, AUTH, SELECT, GET, SET, MGET, MSET,
+ *DEL, EXISTS, INCR, SUBSCRIBE, UNSUBSCRIBE and PUBLISH from an in-memory
+ *store. Any other command gets the reply scripted with `on`, or an error.
+ *
+ * The way replies are written is configurable to reproduce what a real
+ *network does to them: split at arbitrary byte boundaries, delayed, or cut
+ *by a dropped connection. The random choices come from a seeded generator,
+ *so a run can be replayed.
+ *
+ * Every function can be called from any thread. The settings apply to the
+ *commands read after the call returns.
+ **/
+class mock_server
+{
+public:
+  using args = std::vector<std::string>;
+
+  /**
+   * Returns the encoded reply to a command, e.g. mock_server::bulk("value").
+   *An empty string sends no reply.
+   **/
+  using reply_cb = std::function<std::string(const args&)>;
+
+  /**
+   * How replies are written.
+   **/
+  struct write_options
+  {
+    // writes are at most this many bytes, 0 writes whole replies
+    size_t split = 0;
+    // every write is of a random size between 1 and `split` bytes
+    bool random_split = false;
+    // pause between the writes of a split reply, so each one is read on its
+    // own instead of being coalesced by the socket
+    std::chrono::microseconds split_delay{0};
+    // time from reading a command to writing its reply
+    std::chrono::microseconds latency{0};
+    // random extra latency up to this much. Replies keep their order.
+    std::chrono::microseconds jitter{0};
+  };
+
+  /**
+   * Connections and commands served so far.
+   **/
+  struct stats
+  {
+    size_t connections;
+    size_t commands;
+    size_t bytes_written;
+  };
+
+public:
+  mock_server(mock_server&)  = delete;
+  mock_server(mock_server&&) = delete;
+
+  /**
+   * @param seed Seeds the random splits and jitter.
+   **/
+  explicit mock_server(uint32_t seed = 0);
+
+  ~mock_server();
+
+  /**
+   * Returns the address to connect to, as `127.0.0.1:port`.
+   **/
+  std::string address() const;
+
+  uint16_t port() const;
+
+  /**
+   * Scripts the reply to a command, replacing the built-in one if any.
+   *
+   * @param command Is the command name, in any case.
+   * @param cb Is called on the server thread with the command and its
+   *arguments, the name upper cased.
+   **/
+  void on(const std::string& command, reply_cb cb);
+
+  /**
+   * Scripts a fixed reply to a command, e.g. on("GET", bulk("value")).
+   **/
+  void on(const std::string& command, const std::string& reply);
+
+  /**
+   * Sets how replies are written from now on.
+   **/
+  void set_write_options(const write_options& options);
+
+  /**
+   * Cuts the next reply after its first `bytes` bytes and closes the
+   *connection it is written to.
+   **/
+  void drop_next_reply(size_t bytes);
+
+  /**
+   * Closes every connection now.
+   **/
+  void disconnect();
+
+  /**
+   * Publishes `count` messages to the subscribers of `channel`, as fast as
+   *they are read or at `per_second` messages per second. Returns at once,
+   *the messages being sent in the background.
+   **/
+  void flood(const std::string& channel, const std::string& message,
+             size_t count, size_t per_second = 0);
+
+  /**
+   * Returns whether a flood is still being sent.
+   **/
+  bool flooding() const;
+
+  stats get_stats() const;
+
+  // encoders for the scripted replies
+  static std::string simple(std::string_view s);
+  static std::string error(std::string_view s);
+  static std::string integer(int64_t n);
+  static std::string bulk(std::string_view s);
+  static std::string nil();
+  static std::string array(const std::vector<std::string>& encoded);
+
+private:
+  struct session;
+  struct flood_state;
+
+  // runs f on the server thread, waiting for it to finish
+  void run(std::function<void()> f);
+
+  void accept();
+  void read(const std::shared_ptr<session>& s);
+  void handle(const std::shared_ptr<session>& s);
+  std::string execute(const std::shared_ptr<session>& s, args& a);
+  size_t publish(const std::string& channel, const std::string& message);
+
+  // queues a reply, written by the next call to write
+  void send(session& s, std::string reply);
+  void write(const std::shared_ptr<session>& s);
+  void close(const std::shared_ptr<session>& s);
+
+  void flood_tick(std::shared_ptr<flood_state> f);
+
+private:
+  boost::asio::io_context ioc_;
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+      work_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+
+  // everything below is only used on the server thread
+  std::list<std::shared_ptr<session>> sessions_;
+  std::map<std::string, reply_cb> scripts_;
+  std::map<std::string, std::string> store_;
+  std::map<std::string, std::set<std::shared_ptr<session>>> channels_;
+  write_options options_;
+  std::mt19937 random_;
+  std::optional<size_t> drop_after_;
+  std::atomic<size_t> floods_;
+
+  std::atomic<size_t> connections_;
+  std::atomic<size_t> commands_;
+  std::atomic<size_t> bytes_written_;
+
+  std::thread thread_;
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef REDIS_NUMBER_H
+#define REDIS_NUMBER_H
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace redis
+{
+// enough for the shortest representation of any double, e.g.
+// -2.2250738585072014e-308
+constexpr size_t max_double_length = 32;
+
+/**
+ * Writes the shortest text that parses back to exactly `d` into `buf`,
+ *independently of the locale. Infinities are written as inf and -inf, as
+ *the server expects them.
+ **/
+inline std::string_view format_double(double d, char (&buf)[max_double_length])
+{
+  auto res = std::to_chars(buf, buf + max_double_length, d);
+  return {buf, static_cast<size_t>(res.ptr - buf)};
+}
+
+inline void append_double(std::string& out, double d)
+{
+  char buf[max_double_length];
+  out += format_double(d, buf);
+}
+
+/**
+ * Parses a double as sent by the server: scores, INCRBYFLOAT results, geo
+ *distances, inf, +inf and -inf. Fails unless the whole of `s` is a number.
+ **/
+inline bool parse_double(std::string_view s, double& out)
+{
+  // from_chars doesn't accept a leading plus sign
+  if (!s.empty() && s[0] == '+')
+  {
+    s.remove_prefix(1);
+    if (!s.empty() && s[0] == '-')
+      return false;
+  }
+
+  auto end = s.data() + s.size();
+  auto res = std::from_chars(s.data(), end, out);
+
+  return res.ec == std::errc() && res.ptr == end;
+}
+}  // namespace redis
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef REDIS_OTEL_TRACER_H
+#define REDIS_OTEL_TRACER_H
+
+#include <redis/tracing.hpp>
+
+#include <opentelemetry/trace/provider.h>
+#include <opentelemetry/trace/tracer.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace redis
+{
+/**
+ * otel_tracer turns the trace events into OpenTelemetry spans, one client
+ *span per command named after it, from async_write until its handler
+ *returns. The writes, the first byte of the reply and its parsing are added
+ *to the span as events.
+ *
+ * The span starts in async_write, so its parent is the span active on the
+ *calling thread: the Redis calls of a request show in its trace.
+ *
+ * Needs the library built with REDIS_CLIENT_OTEL, which enables
+ *REDIS_CLIENT_TRACING and links the OpenTelemetry API:
+ *
+ *   redis::trace::set_tracer(std::make_shared<redis::otel_tracer>());
+ **/
+class otel_tracer : public trace::tracer
+{
+public:
+  using span_ptr =
+      opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>;
+  using tracer_ptr =
+      opentelemetry::nostd::shared_ptr<opentelemetry::trace::Tracer>;
+
+public:
+  /**
+   * @param tracer Is where the spans are created, the global provider's
+   *tracer by default.
+   **/
+  explicit otel_tracer(tracer_ptr tracer = opentelemetry::trace::Provider::
+                           GetTracerProvider()
+                               ->GetTracer("redp"))
+      : tracer_(std::move(tracer))
+  {
+  }
+
+  void on_event(const trace::event& e) override
+  {
+    using trace::event_type;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    switch (e.type)
+    {
+      case event_type::enqueued:
+      {
+        std::string name(e.name);
+
+        opentelemetry::trace::StartSpanOptions options;
+        options.kind = opentelemetry::trace::SpanKind::kClient;
+
+        auto span = tracer_->StartSpan(
+            name, {{"db.system", "redis"}, {"db.operation", name}}, options);
+
+        spans_.emplace(key{e.connection, e.first}, state{span, false});
+        break;
+      }
+
+      case event_type::write_started:
+      case event_type::write_completed:
+      {
+        auto name = e.type == event_type::write_started ? "write_started"
+                                                        : "write_completed";
+
+        for (auto it = spans_.lower_bound({e.connection, e.first});
+             it != spans_.end() && it->first.first == e.connection &&
+             it->first.second <= e.last;
+             ++it)
+        {
+          it->second.span->AddEvent(name);
+        }
+        break;
+      }
+
+      case event_type::first_byte:
+      case event_type::parsed:
+      {
+        auto it = spans_.find({e.connection, e.first});
+        if (it == spans_.end())
+          break;
+
+        if (e.type == event_type::first_byte)
+          it->second.span->AddEvent("first_byte");
+        else
+        {
+          it->second.span->AddEvent("parsed");
+          it->second.parsed = true;
+
+          if (e.error_reply)
+            it->second.span->SetStatus(opentelemetry::trace::StatusCode::kError,
+                                       "error reply");
+        }
+        break;
+      }
+
+      case event_type::handler_completed:
+      {
+        auto it = spans_.find({e.connection, e.first});
+        if (it == spans_.end())
+          break;
+
+        // completed without a reply: lost, timed out or cancelled
+        if (!it->second.parsed)
+          it->second.span->SetStatus(opentelemetry::trace::StatusCode::kError,
+                                     e.ec ? e.ec.message() : "no reply");
+
+        it->second.span->End();
+        spans_.erase(it);
+        break;
+      }
+
+      case event_type::disconnected:
+      {
+        for (auto it = spans_.lower_bound({e.connection, 0});
+             it != spans_.end() && it->first.first == e.connection; ++it)
+        {
+          it->second.span->AddEvent("disconnected");
+        }
+        break;
+      }
+
+      case event_type::connected:
+        break;
+    }
+  }
+
+private:
+  // the connection and the command id
+  using key = std::pair<const void*, uint64_t>;
+
+  struct state
+  {
+    span_ptr span;
+    bool parsed;
+  };
+
+  tracer_ptr tracer_;
+
+  std::mutex mutex_;
+  std::map<key, state> spans_;
+};
+}  // namespace redis
+
+#endif
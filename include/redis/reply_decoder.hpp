@@ -0,0 +1,360 @@
+#ifndef REDIS_REPLY_DECODER_H
+#define REDIS_REPLY_DECODER_H
+
+#include <redis/error.hpp>
+#include <redis/number.hpp>
+#include <redis/resp_reader.hpp>
+
+#include <boost/container/flat_map.hpp>
+#include <charconv>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace redis
+{
+/**
+ * Type for replies whose content doesn't matter. Server errors are still
+ *reported.
+ **/
+struct ignore_t
+{
+};
+
+/**
+ * reply_decoder<T> decodes a reply straight from the read buffer into a T.
+ *
+ * Every specialization has the following function:
+ *
+ *   static bool decode(resp_reader& r, const resp_reader::value& v, T& out,
+ *                      boost::system::error_code& ec);
+ *
+ * `v` is the value already read from `r`. The function returns false if the
+ *buffer ends before the reply does. Otherwise the whole reply has been
+ *consumed from `r`, even if it couldn't be decoded, in which case `ec` is
+ *set.
+ *
+ * Specializing it makes a new type available to the typed commands.
+ **/
+template<class T, class Enable = void>
+struct reply_decoder;
+
+/**
+ * Reads the next reply from `r` into `out`.
+ **/
+template<class T>
+bool decode_reply(resp_reader& r, T& out, boost::system::error_code& ec)
+{
+  resp_reader::value v;
+  if (!r.next(v))
+    return false;
+
+  return reply_decoder<T>::decode(r, v, out, ec);
+}
+
+/**
+ * Consumes a reply that can't be decoded, setting `ec` accordingly.
+ **/
+inline bool decode_mismatch(resp_reader& r, const resp_reader::value& v,
+                            boost::system::error_code& ec)
+{
+  for (int64_t i = 0; v.type == '*' && i < v.size; i++)
+  {
+    if (!r.skip())
+      return false;
+  }
+
+  // the first error of an array wins
+  if (ec)
+    return true;
+
+  if (v.type != '-')
+    ec = errc::unexpected_reply;
+  else if (v.data.rfind("WRONGTYPE", 0) == 0)
+    ec = errc::wrong_type;
+  else if (v.data.rfind("NOSCRIPT", 0) == 0)
+    ec = errc::no_script;
+  else
+    ec = errc::server_error;
+
+  return true;
+}
+
+template<>
+struct reply_decoder<ignore_t>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v, ignore_t&,
+                     boost::system::error_code& ec)
+  {
+    if (v.type == '-')
+      return decode_mismatch(r, v, ec);
+
+    for (int64_t i = 0; v.type == '*' && i < v.size; i++)
+    {
+      if (!r.skip())
+        return false;
+    }
+
+    return true;
+  }
+};
+
+template<>
+struct reply_decoder<std::string>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     std::string& out, boost::system::error_code& ec)
+  {
+    if ((v.type != '$' && v.type != '+') || v.is_null)
+      return decode_mismatch(r, v, ec);
+
+    out.assign(v.data);
+    return true;
+  }
+};
+
+// integers, also accepted as strings since e.g. HGET returns counters as such
+template<class T>
+struct reply_decoder<
+    T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v, T& out,
+                     boost::system::error_code& ec)
+  {
+    if (v.type == ':')
+    {
+      out = static_cast<T>(v.size);
+      return true;
+    }
+
+    if ((v.type == '$' || v.type == '+') && !v.is_null)
+    {
+      auto end = v.data.data() + v.data.size();
+      auto res = std::from_chars(v.data.data(), end, out);
+      if (res.ec == std::errc() && res.ptr == end)
+        return true;
+    }
+
+    return decode_mismatch(r, v, ec);
+  }
+};
+
+// scores, INCRBYFLOAT results, geo distances, ...
+template<class T>
+struct reply_decoder<T, std::enable_if_t<std::is_floating_point_v<T>>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v, T& out,
+                     boost::system::error_code& ec)
+  {
+    if (v.type == ':')
+    {
+      out = static_cast<T>(v.size);
+      return true;
+    }
+
+    double d;
+    if ((v.type == '$' || v.type == '+') && !v.is_null &&
+        parse_double(v.data, d))
+    {
+      out = static_cast<T>(d);
+      return true;
+    }
+
+    return decode_mismatch(r, v, ec);
+  }
+};
+
+// +OK, 1 and any string are true; 0 and nil are false
+template<>
+struct reply_decoder<bool>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v, bool& out,
+                     boost::system::error_code& ec)
+  {
+    if (v.type == ':')
+    {
+      out = v.size != 0;
+      return true;
+    }
+
+    if (v.type == '+' || v.type == '$' || (v.type == '*' && v.is_null))
+    {
+      out = !v.is_null;
+      return true;
+    }
+
+    return decode_mismatch(r, v, ec);
+  }
+};
+
+// nil is std::nullopt
+template<class T>
+struct reply_decoder<std::optional<T>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     std::optional<T>& out, boost::system::error_code& ec)
+  {
+    if ((v.type == '$' || v.type == '*') && v.is_null)
+    {
+      out.reset();
+      return true;
+    }
+
+    return reply_decoder<T>::decode(r, v, out.emplace(), ec);
+  }
+};
+
+// nil is an empty vector
+template<class T>
+struct reply_decoder<std::vector<T>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     std::vector<T>& out, boost::system::error_code& ec)
+  {
+    out.clear();
+
+    if (v.type != '*')
+      return decode_mismatch(r, v, ec);
+
+    if (v.is_null)
+      return true;
+
+    out.resize(v.size);
+    for (auto&& element : out)
+    {
+      if (!decode_reply(r, element, ec))
+        return false;
+    }
+
+    return true;
+  }
+};
+
+// two element arrays, e.g. the key and value returned by BLPOP
+template<class A, class B>
+struct reply_decoder<std::pair<A, B>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     std::pair<A, B>& out, boost::system::error_code& ec)
+  {
+    if (v.type != '*' || v.size != 2)
+      return decode_mismatch(r, v, ec);
+
+    return decode_reply(r, out.first, ec) && decode_reply(r, out.second, ec);
+  }
+};
+
+// flat arrays of pairs keeping the order, e.g. ZRANGE WITHSCORES
+template<class A, class B>
+struct reply_decoder<std::vector<std::pair<A, B>>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     std::vector<std::pair<A, B>>& out,
+                     boost::system::error_code& ec)
+  {
+    out.clear();
+
+    if (v.type != '*' || v.size % 2 != 0)
+      return decode_mismatch(r, v, ec);
+
+    out.resize(v.size / 2);
+    for (auto&& pair : out)
+    {
+      if (!decode_reply(r, pair.first, ec) || !decode_reply(r, pair.second, ec))
+        return false;
+    }
+
+    return true;
+  }
+};
+
+// integers in the unit of the duration, e.g. seconds for TTL
+template<class Rep, class Period>
+struct reply_decoder<std::chrono::duration<Rep, Period>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     std::chrono::duration<Rep, Period>& out,
+                     boost::system::error_code& ec)
+  {
+    Rep count{};
+    if (!reply_decoder<Rep>::decode(r, v, count, ec))
+      return false;
+
+    out = std::chrono::duration<Rep, Period>(count);
+    return true;
+  }
+};
+
+// flat arrays of field and value pairs, as returned by HGETALL
+template<class Map>
+struct map_reply_decoder
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v, Map& out,
+                     boost::system::error_code& ec)
+  {
+    out.clear();
+
+    if (v.type != '*' || v.size % 2 != 0)
+      return decode_mismatch(r, v, ec);
+
+    for (int64_t i = 0; i < v.size; i += 2)
+    {
+      typename Map::key_type key;
+      typename Map::mapped_type value;
+
+      if (!decode_reply(r, key, ec) || !decode_reply(r, value, ec))
+        return false;
+
+      out.emplace(std::move(key), std::move(value));
+    }
+
+    return true;
+  }
+};
+
+template<class K, class V, class... Rest>
+struct reply_decoder<std::map<K, V, Rest...>>
+    : map_reply_decoder<std::map<K, V, Rest...>>
+{
+};
+
+template<class K, class V, class... Rest>
+struct reply_decoder<std::unordered_map<K, V, Rest...>>
+    : map_reply_decoder<std::unordered_map<K, V, Rest...>>
+{
+};
+
+// inserting one by one into a flat_map is quadratic, the pairs are inserted
+// as a range instead
+template<class K, class V, class... Rest>
+struct reply_decoder<boost::container::flat_map<K, V, Rest...>>
+{
+  static bool decode(resp_reader& r, const resp_reader::value& v,
+                     boost::container::flat_map<K, V, Rest...>& out,
+                     boost::system::error_code& ec)
+  {
+    out.clear();
+
+    if (v.type != '*' || v.size % 2 != 0)
+      return decode_mismatch(r, v, ec);
+
+    std::vector<std::pair<K, V>> pairs(v.size / 2);
+    for (auto&& pair : pairs)
+    {
+      if (!decode_reply(r, pair.first, ec) || !decode_reply(r, pair.second, ec))
+        return false;
+    }
+
+    out.insert(std::make_move_iterator(pairs.begin()),
+               std::make_move_iterator(pairs.end()));
+    return true;
+  }
+};
+}  // namespace redis
+
+#endif
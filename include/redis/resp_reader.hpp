@@ -0,0 +1,140 @@
+#ifndef REDIS_RESP_READER_H
+#define REDIS_RESP_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace redis
+{
+/**
+ * resp_reader walks a RESP buffer in place without building any
+ * redis::types object.
+ *
+ * Every read function returns false if the buffer ends before the value does.
+ * In that case the reader position is unspecified and the caller should
+ * start again from the beginning once more data is available.
+ **/
+class resp_reader
+{
+public:
+  /**
+   * A single RESP value. For arrays only the header is read; the elements
+   * follow in the buffer.
+   **/
+  struct value
+  {
+    // one of + - : $ *
+    char type;
+    // integer value, bulk length or number of array elements
+    int64_t size;
+    // contents of simple strings, errors and bulk strings
+    std::string_view data;
+    // null bulk string or null array
+    bool is_null;
+  };
+
+public:
+  resp_reader(const char* s, size_t n);
+
+  /**
+   * Reads the next value.
+   *
+   * @param v Is set to the value read.
+   **/
+  bool next(value& v);
+
+  /**
+   * Skips the next value, including all the elements if it is an array.
+   **/
+  bool skip();
+
+  /**
+   * Skips the next value like `skip()`, keeping what `next` would have read.
+   *
+   * @param v Is set to the value skipped.
+   **/
+  bool skip(value& v);
+
+  /**
+   * Returns how many more bytes the first reply of [s, s + n) needs at
+   * least: the rest of the bulk string it is cut in, 0 if it is complete or
+   * the amount isn't known yet.
+   **/
+  static size_t missing(const char* s, size_t n);
+
+  /**
+   * Returns the number of bytes read so far.
+   **/
+  size_t position() const
+  {
+    return i_;
+  }
+
+  /**
+   * Returns whether every byte of the buffer has been read.
+   **/
+  bool empty() const
+  {
+    return i_ >= n_;
+  }
+
+private:
+  friend class reply_scanner;
+
+  // reads up to the next CRLF, leaving the cursor after it
+  bool line(std::string_view& l);
+
+private:
+  const char* s_;
+  size_t n_;
+  size_t i_;
+  // bytes missing from the bulk string next() stopped in
+  size_t missing_;
+};
+
+/**
+ * reply_scanner finds where a reply arriving in pieces ends. Each call
+ *resumes after the last value complete in the previous one, so every byte
+ *of the reply is scanned once however many reads it takes.
+ **/
+class reply_scanner
+{
+public:
+  /**
+   * Returns the size of the reply at the start of [s, s + n), or 0 if it
+   *isn't complete yet. Until the reply is complete, every call must be
+   *given the same reply, more of it or not. The scanner is then ready for
+   *the next one.
+   **/
+  size_t scan(const char* s, size_t n);
+
+  /**
+   * Returns how many more bytes the reply needs at least after a scan that
+   *didn't complete it, see resp_reader::missing.
+   **/
+  size_t missing() const
+  {
+    return missing_;
+  }
+
+  /**
+   * Forgets the reply being scanned, e.g. once it was read past otherwise.
+   **/
+  void reset()
+  {
+    scanned_ = 0;
+    left_    = 1;
+    missing_ = 0;
+  }
+
+private:
+  // bytes of the values complete so far
+  size_t scanned_ = 0;
+  // values still to scan, the elements of the arrays found included
+  int64_t left_ = 1;
+  size_t missing_ = 0;
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef REDIS_SCANNER_H
+#define REDIS_SCANNER_H
+
+#include <redis/stream.hpp>
+
+#include <string>
+#include <vector>
+
+namespace redis
+{
+/**
+ * A page returned by a SCAN family command.
+ **/
+struct scan_page
+{
+  // keys for SCAN, members for SSCAN, field and value pairs for HSCAN and
+  // member and score pairs for ZSCAN
+  std::vector<std::string> items;
+
+  // set on the last page of the iteration
+  bool last;
+
+  // set if the server returned an error, which also ends the iteration
+  redis::types::error error;
+};
+
+/**
+ * scanner iterates the keyspace or a hash, set or sorted set using the
+ *cursor based SCAN family of commands.
+ *
+ * As soon as a page arrives the next one is requested, so the following
+ *page is already on its way while the caller processes the current one.
+ *The scanner must outlive the pages in flight.
+ **/
+class scanner
+{
+public:
+  using page_cb = std::function<void(scan_page&)>;
+
+  enum command
+  {
+    scan,
+    hscan,
+    sscan,
+    zscan
+  };
+
+public:
+  scanner()          = delete;
+  scanner(scanner&)  = delete;
+  scanner(scanner&&) = delete;
+
+  /**
+   * @param s Is the stream the commands are sent through.
+   * @param cmd Is the command used to iterate.
+   * @param key Is the key of the hash, set or sorted set. Ignored by
+   *`scanner::scan`.
+   **/
+  scanner(redis::stream& s, command cmd = command::scan,
+          const std::string& key = "");
+
+  /**
+   * Only returns the elements matching a glob-style pattern (MATCH).
+   **/
+  void set_match(const std::string& pattern)
+  {
+    match_ = pattern;
+  }
+
+  /**
+   * Hints how many elements each page should have (COUNT).
+   **/
+  void set_count(size_t count)
+  {
+    count_ = count;
+  }
+
+  /**
+   * Only returns keys of the given type (TYPE). Only valid for
+   *`scanner::scan`.
+   **/
+  void set_type(const std::string& type)
+  {
+    type_ = type;
+  }
+
+  /**
+   * Gets the next page.
+   *
+   * Pages can be empty even if the iteration isn't over. Once the last page
+   *was delivered the callback gets empty pages marked as last.
+   *
+   * @param cb Is the callback that will get called with the page. Only one
+   *call to `async_next` can be outstanding at a time.
+   **/
+  void async_next(page_cb cb);
+
+  /**
+   * Starts the iteration over. Pages in flight are discarded.
+   **/
+  void reset();
+
+private:
+  void request();
+  void on_reply(any_type reply, size_t generation);
+
+private:
+  redis::stream& stream_;
+
+  command command_;
+  std::string key_;
+
+  std::string match_;
+  size_t count_;
+  std::string type_;
+
+  std::string cursor_;
+
+  // page received before it was asked for
+  scan_page ready_;
+  bool has_ready_;
+
+  page_cb waiting_cb_;
+
+  bool in_flight_;
+  bool finished_;
+
+  // replies from before a reset are ignored
+  size_t generation_;
+};
+}  // namespace redis
+
+#endif
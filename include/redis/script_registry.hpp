@@ -0,0 +1,73 @@
+#ifndef REDIS_SCRIPT_REGISTRY_H
+#define REDIS_SCRIPT_REGISTRY_H
+
+#include <redis/stream.hpp>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace redis
+{
+/**
+ * script_registry runs Lua scripts by their SHA1 so the body of a script is
+ *only sent once per connection.
+ *
+ * The scripts are loaded with SCRIPT LOAD every time the stream connects.
+ *If the server still doesn't know a script (e.g. after SCRIPT FLUSH) it is
+ *loaded again and the EVALSHA retried, so the caller never sees NOSCRIPT.
+ *
+ * The registry must outlive the stream it was created with.
+ **/
+class script_registry
+{
+public:
+  script_registry()                  = delete;
+  script_registry(script_registry&)  = delete;
+  script_registry(script_registry&&) = delete;
+
+  /**
+   * @param s Is the stream the scripts are run on.
+   **/
+  script_registry(redis::stream& s);
+
+  /**
+   * Registers a script.
+   *
+   * The script is loaded straight away if the stream is connected, and on
+   *every connection otherwise.
+   *
+   * @param body Is the Lua source of the script.
+   * @return The SHA1 of the script used to run it.
+   **/
+  std::string add(const std::string& body);
+
+  /**
+   * Runs a registered script with EVALSHA.
+   *
+   * @param sha Is the value returned by `add`.
+   * @param keys Are the key names passed as KEYS.
+   * @param args Are the arguments passed as ARGV.
+   * @param cb Is the callback that will get called with the script result.
+   **/
+  void async_eval(const std::string& sha, const std::vector<std::string>& keys,
+                  const std::vector<std::string>& args, stream::handler cb);
+
+  /**
+   * Returns the lowercase hex SHA1 of a script, as Redis computes it.
+   **/
+  static std::string sha1(std::string_view body);
+
+private:
+  void load(const std::string& body);
+
+private:
+  redis::stream& stream_;
+
+  // script bodies by SHA1
+  std::unordered_map<std::string, std::string> scripts_;
+};
+}  // namespace redis
+
+#endif
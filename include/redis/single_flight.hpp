@@ -0,0 +1,154 @@
+#ifndef REDIS_SINGLE_FLIGHT_H
+#define REDIS_SINGLE_FLIGHT_H
+
+#include <redis/completion.hpp>
+#include <redis/stream.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace redis
+{
+/**
+ * single_flight sends a read once while it is in flight: the same command
+ *issued again before its reply arrives waits for that reply instead of
+ *going to the server. The reply is parsed once and every caller gets the
+ *same immutable value.
+ *
+ * Only meant for commands without side effects, e.g. the GETs of a hot key
+ *that just expired. A read joining a flight may not see the writes issued
+ *after the flight started.
+ *
+ * The single_flight must outlive the commands sent through it.
+ **/
+class single_flight
+{
+public:
+  single_flight()                = delete;
+  single_flight(single_flight&)  = delete;
+  single_flight(single_flight&&) = delete;
+
+  /**
+   * @param s Is the stream the commands are sent through.
+   **/
+  single_flight(redis::stream& s)
+      : stream_(s)
+      , shared_(0)
+  {
+  }
+
+  /**
+   * Sends a typed command, or waits for the reply of the same command
+   *already in flight. Commands are the same if they are encoded the same
+   *and decoded into the same `T`.
+   *
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, std::shared_ptr<const T>), the value is
+   *null on errors.
+   * @param cmd Is the command to send, e.g. `cmd::get("key")`.
+   **/
+  template<class CompletionToken, class T>
+  auto async_write(CompletionToken&& token, const typed_command<T>& cmd)
+  {
+    return boost::asio::async_initiate<
+        CompletionToken,
+        void(boost::system::error_code, std::shared_ptr<const T>)>(
+        [this](auto&& handler, const typed_command<T>& cmd)
+        {
+          auto& entry = *flights_.try_emplace({typeid(T), cmd.data()}).first;
+          if (!entry.second)
+            entry.second = std::make_unique<flight<T>>();
+
+          // the key holds T, the flight was made for it
+          auto& f = static_cast<flight<T>&>(*entry.second);
+
+          f.waiters.push_back(flight<T>::waiter::make(
+              std::forward<decltype(handler)>(handler),
+              stream_.get_executor()));
+          if (f.waiters.size() > 1)
+          {
+            shared_++;
+            return;
+          }
+
+          stream_.async_write(
+              [this, &entry](boost::system::error_code ec, T value)
+              {
+                std::shared_ptr<const T> shared;
+                if (!ec)
+                  shared = std::make_shared<const T>(std::move(value));
+
+                finish(entry, ec, std::move(shared));
+              },
+              cmd);
+        },
+        token, cmd);
+  }
+
+  /**
+   * Returns how many commands got the reply of another so far.
+   **/
+  size_t shared() const
+  {
+    return shared_;
+  }
+
+private:
+  // the callers waiting for a command in flight, the first one sent it
+  struct flight_base
+  {
+    virtual ~flight_base() = default;
+  };
+
+  template<class T>
+  struct flight : flight_base
+  {
+    using waiter =
+        completion<boost::system::error_code, std::shared_ptr<const T>>;
+
+    std::vector<std::unique_ptr<waiter>> waiters;
+  };
+
+  // the reply type and the command encoded
+  using key = std::pair<std::type_index, std::string>;
+
+  struct key_hash
+  {
+    size_t operator()(const key& k) const
+    {
+      return std::hash<std::string>()(k.second) ^ k.first.hash_code();
+    }
+  };
+
+  using flight_map =
+      std::unordered_map<key, std::unique_ptr<flight_base>, key_hash>;
+
+  // completes the callers of a flight. Those sending the same command from
+  // their handler start another one.
+  template<class T>
+  void finish(flight_map::value_type& entry, boost::system::error_code ec,
+              std::shared_ptr<const T> value)
+  {
+    auto waiters = std::move(static_cast<flight<T>&>(*entry.second).waiters);
+    flights_.erase(flights_.find(entry.first));
+
+    for (auto&& w : waiters)
+      w->complete(ec, value);
+  }
+
+private:
+  redis::stream& stream_;
+
+  // the flight of each command, by reply type. The elements don't move when
+  // the map grows.
+  flight_map flights_;
+  size_t shared_;
+};
+}  // namespace redis
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef REDIS_SPSC_QUEUE_H
+#define REDIS_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace redis
+{
+/**
+ * Bounded lock-free queue for exactly one producer thread and one consumer
+ * thread.
+ *
+ * The capacity is rounded up to the next power of two. Slots are
+ * default-constructed up front and reused, so pushing and popping never
+ * allocates.
+ **/
+template<class T>
+class spsc_queue
+{
+public:
+  spsc_queue(const spsc_queue&) = delete;
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  explicit spsc_queue(size_t capacity)
+      : mask_(round_up(capacity) - 1)
+      , slots_(new T[mask_ + 1])
+      , head_(0)
+      , tail_(0)
+      , cached_head_(0)
+      , cached_tail_(0)
+  {
+  }
+
+  /**
+   * Moves `v` into the queue. Producer side only.
+   *
+   * Returns false (leaving `v` untouched) when the queue is full.
+   **/
+  bool try_push(T& v)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_)
+    {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_)
+        return false;
+    }
+
+    slots_[tail & mask_] = std::move(v);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Moves the oldest element into `v`. Consumer side only.
+   *
+   * Returns false when the queue is empty.
+   **/
+  bool try_pop(T& v)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_)
+    {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_)
+        return false;
+    }
+
+    v = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Returns whether the queue is empty. It is only exact when called from
+   * the consumer thread.
+   **/
+  bool empty() const
+  {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const
+  {
+    return mask_ + 1;
+  }
+
+private:
+  static size_t round_up(size_t n)
+  {
+    size_t r = 2;
+    while (r < n)
+      r <<= 1;
+    return r;
+  }
+
+private:
+  // keep the indices of each side on their own cache line
+  static constexpr size_t cache_line = 64;
+
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  alignas(cache_line) std::atomic<size_t> head_;
+  alignas(cache_line) std::atomic<size_t> tail_;
+
+  // producer's copy of head_ and consumer's copy of tail_
+  alignas(cache_line) size_t cached_head_;
+  alignas(cache_line) size_t cached_tail_;
+};
+}  // namespace redis
+
+#endif
@@ -4,17 +4,46 @@
 #include <boost/asio.hpp>
 #include <boost/core/ignore_unused.hpp>
 #include <redis/basic_stream.hpp>
+#include <redis/command.hpp>
+#include <redis/completion.hpp>
+#include <redis/error.hpp>
+#include <redis/metrics.hpp>
 #include <redis/parser.hpp>
+#include <redis/reply_decoder.hpp>
+#include <redis/resp_reader.hpp>
+#include <redis/tracing.hpp>
+#include <redis/transaction.hpp>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #ifndef DEFAULT_READ_SIZE
 #define DEFAULT_READ_SIZE 1024
 #endif
 
+// per-operation cancellation came with Asio 1.19, Boost 1.77
+#if BOOST_ASIO_VERSION >= 101900
+#define REDIS_CLIENT_HAS_CANCELLATION
+#endif
+
 namespace redis
 {
 using any_type = redis::parser::any_type;
 
+/**
+ * The lanes of a stream, from the first written to the last.
+ **/
+enum class priority
+{
+  high,
+  normal,
+  low
+};
+
 /**
  * stream represents a direct stream to redis.
  * The class will automatically reconnect if the connection is lost.
@@ -22,7 +51,11 @@ using any_type = redis::parser::any_type;
 class stream
 {
 public:
-  using handler = std::function<void(any_type)>;
+  using handler      = std::function<void(any_type)>;
+  using exec_handler = std::function<void(transaction_result)>;
+  using prepare_cb =
+      std::function<void(transaction&, std::function<void()> commit)>;
+  using duration = std::chrono::steady_clock::duration;
 
 public:
   stream()         = delete;
@@ -34,6 +67,8 @@ public:
    **/
   stream(boost::asio::io_context& ioc);
 
+  ~stream();
+
   /**
    * Returns the io_context passed on the constructor.
    **/
@@ -46,7 +81,7 @@ public:
    *boost::system::error_code error is encountered.
    *
    * @param hostport Should be a valid host and port in the following format
-   * `host:port`.
+   * `host:port`, or the path of a unix domain socket as `unix:///path`.
    **/
   void connect(const std::string& hostport);
 
@@ -56,7 +91,7 @@ public:
    * This function will not throw any exception.
    *
    * @param hostport Should be a valid host and port in the following format
-   *`host:port`.
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
    * @param ec Is a valid reference to a boost::system::error_code that will be
    *set by the function if any error happens.
    **/
@@ -85,17 +120,90 @@ public:
   void connect(const std::string& host, const std::string& port,
                boost::system::error_code& ec) noexcept;
 
+  /**
+   * Makes the connections use TLS, with the session resumed on every
+   *reconnection. Must be called before connecting.
+   *
+   * @param ctx Is the context the connections are made with. It must
+   *outlive the stream.
+   * @param options Are the server name, ciphers and ALPN protocols.
+   **/
+  void set_tls(boost::asio::ssl::context& ctx,
+               tls_options options = {})
+  {
+    stream_.set_tls(ctx, std::move(options));
+  }
+
+  /**
+   * Sets the commands sent first on every connection, the reconnections
+   *included, all in one write. The commands sent through the stream wait
+   *until every one of them succeeded, so none reaches a connection that
+   *isn't authenticated or on the right database.
+   *
+   * If the server replies with an error, e.g. a wrong password or LOADING,
+   *connect and async_connect fail with redis::errc::handshake_failed and the
+   *stream is closed. A reconnection failing so is made again a second later.
+   *
+   * Takes effect on the next connection.
+   *
+   * @param options Are the credentials, client name, database and other
+   *commands to send.
+   **/
+  void set_handshake(handshake_options options)
+  {
+    stream_.set_handshake(std::move(options));
+  }
+
+  /**
+   * Returns the error the server replied to the last handshake, empty if it
+   *succeeded.
+   **/
+  const std::string& handshake_error() const
+  {
+    return stream_.handshake_error();
+  }
+
+  /**
+   * Keeps spare connections open, opened right after connecting, so a lost
+   *connection is replaced without resolving or connecting again. The
+   *spare connections aren't authenticated ahead: the handshake, see
+   *set_handshake, and the add_on_connected callbacks run on the one taking
+   *over as on any reconnection.
+   *
+   * @param count Is how many to keep, 0 for none.
+   **/
+  void set_standby(size_t count)
+  {
+    stream_.set_standby(count);
+  }
+
+  /**
+   * Sets how long the addresses the host resolved to are reused by the
+   *reconnections, see basic_stream::set_resolve_ttl.
+   **/
+  void set_resolve_ttl(std::chrono::steady_clock::duration ttl)
+  {
+    stream_.set_resolve_ttl(ttl);
+  }
+
   /**
    * Establishes a connection to a redis instance asynchronously.
    *
    * This function will return immediately.
    *
    * @param hostport Should be a valid host and port in the following format
-   *`host:port`.
-   * @param cb Is the callback that will get called when the operation ends.
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
+   * @param token Is the completion token, a callback or e.g.
+   *`boost::asio::use_awaitable`. The signature is
+   *void(boost::system::error_code).
    **/
-  void async_connect(const std::string& hostport,
-                     basic_stream::on_connect_cb cb) noexcept;
+  template<class CompletionToken>
+  auto async_connect(const std::string& hostport, CompletionToken&& token)
+  {
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code)>(
+        connect_op{this, hostport, {}, false}, token, get_executor());
+  }
 
   /**
    * Establishes a connection to a redis instance asynchronously.
@@ -104,38 +212,304 @@ public:
    *
    * @param host Is a valid hostname or IP.
    * @param port Is a valid port as a string.
-   * @param cb Is the callback that will get called when the operation ends.
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code).
    **/
-  void async_connect(const std::string& host, const std::string& port,
-                     basic_stream::on_connect_cb cb) noexcept;
+  template<class CompletionToken>
+  auto async_connect(const std::string& host, const std::string& port,
+                     CompletionToken&& token)
+  {
+    return boost::asio::async_compose<CompletionToken,
+                                      void(boost::system::error_code)>(
+        connect_op{this, host, port, false}, token, get_executor());
+  }
 
   /**
    * Sends a command to the REDIS server.
    *
-   * @param cb Is the callback that will get called after the command has been
-   *acknowledged by the server.
+   * @param token Is the completion token, a callback or e.g.
+   *`boost::asio::use_awaitable`, that completes once the command has been
+   *acknowledged by the server. The signature is void(any_type).
    * @param args Are the command and arguments to send to the server. For
-   *example: "SET", "key", "value". The parameters can be any type convertible
-   *to std::string, double, int(32|64) and any of the redis::types.
+   *example: "SET", "key", "value". The parameters can be any type with a
+   *redis::arg_traits: strings, numbers, durations, the redis::types and
+   *ranges of them, e.g. "HSET", "key", std::map<std::string, int>.
+   **/
+  template<class CompletionToken, class... Args>
+  auto async_write(CompletionToken&& token, const Args&... args)
+  {
+    return boost::asio::async_initiate<CompletionToken, void(any_type)>(
+        [this](auto&& handler, auto&&... args)
+        {
+          command::encode(buffer(priority::normal), args...);
+
+          enqueue<any_reply>(std::forward<decltype(handler)>(handler), 0,
+                             command_timeout_, priority::normal);
+        },
+        token, args...);
+  }
+
+  /**
+   * Sends a command whose arguments are only known at runtime.
+   *
+   * @param token Is the completion token. The signature is void(any_type).
+   * @param args Are the command and its arguments. For example: {"SCAN", "0",
+   *"COUNT", "100"}.
+   **/
+  template<class CompletionToken>
+  auto async_write(CompletionToken&& token,
+                   const std::vector<std::string>& args)
+  {
+    return boost::asio::async_initiate<CompletionToken, void(any_type)>(
+        [this](auto&& handler, const std::vector<std::string>& args)
+        {
+          command::encode(buffer(priority::normal), args);
+
+          enqueue<any_reply>(std::forward<decltype(handler)>(handler), 0,
+                             command_timeout_, priority::normal);
+        },
+        token, args);
+  }
+
+  /**
+   * Sends a command encoded beforehand.
+   *
+   * @param token Is the completion token. The signature is void(any_type).
+   * @param cmd Is the command to send.
+   **/
+  template<class CompletionToken>
+  auto async_write(CompletionToken&& token, const command& cmd)
+  {
+    return boost::asio::async_initiate<CompletionToken, void(any_type)>(
+        [this](auto&& handler, const command& cmd)
+        {
+          buffer(priority::normal) += cmd.data();
+
+          enqueue<any_reply>(std::forward<decltype(handler)>(handler), 0,
+                             command_timeout_, priority::normal);
+        },
+        token, cmd);
+  }
+
+  /**
+   * Sends a command encoded beforehand, with a deadline of its own.
+   *
+   * @param token Is the completion token. The signature is void(any_type).
+   * @param cmd Is the command to send.
+   * @param timeout Is how long to wait for the reply, instead of the timeout
+   *set with `set_command_timeout`. The handler is then called with an
+   *"ERR command timed out" error.
+   **/
+  template<class CompletionToken, class Rep, class Period>
+  auto async_write(CompletionToken&& token, const command& cmd,
+                   std::chrono::duration<Rep, Period> timeout)
+  {
+    return async_write(std::forward<CompletionToken>(token), cmd,
+                       priority::normal, timeout);
+  }
+
+  /**
+   * Sends a command encoded beforehand in the lane of `p`. It is written
+   *before the commands of the lower priorities not written yet.
+   *
+   * @param token Is the completion token. The signature is void(any_type).
+   * @param cmd Is the command to send.
+   * @param p Is the lane of the command.
+   **/
+  template<class CompletionToken>
+  auto async_write(CompletionToken&& token, const command& cmd, priority p)
+  {
+    return async_write(std::forward<CompletionToken>(token), cmd, p,
+                       command_timeout_);
+  }
+
+  /**
+   * Sends a command encoded beforehand in the lane of `p`, with a deadline of
+   *its own.
+   *
+   * @param token Is the completion token. The signature is void(any_type).
+   * @param cmd Is the command to send.
+   * @param p Is the lane of the command.
+   * @param timeout Is how long to wait for the reply, 0 to wait forever.
+   **/
+  template<class CompletionToken, class Rep, class Period>
+  auto async_write(CompletionToken&& token, const command& cmd, priority p,
+                   std::chrono::duration<Rep, Period> timeout)
+  {
+    return boost::asio::async_initiate<CompletionToken, void(any_type)>(
+        [this](auto&& handler, const command& cmd, priority p,
+               duration timeout)
+        {
+          buffer(p) += cmd.data();
+
+          enqueue<any_reply>(std::forward<decltype(handler)>(handler), 0,
+                             timeout, p);
+        },
+        token, cmd, p,
+        std::chrono::duration_cast<duration>(timeout));
+  }
+
+  /**
+   * Sends a typed command. The reply is decoded straight into a `T`.
+   *
+   * Server errors and replies that can't be decoded into a `T` complete the
+   *operation with a redis::errc error.
+   *
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, T).
+   * @param cmd Is the command to send, e.g. `cmd::incr("counter")`.
+   **/
+  template<class CompletionToken, class T>
+  auto async_write(CompletionToken&& token, const typed_command<T>& cmd)
+  {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(boost::system::error_code, T)>(
+        [this](auto&& handler, const typed_command<T>& cmd)
+        {
+          buffer(priority::normal) += cmd.data();
+
+          enqueue<typed_reply<T>>(std::forward<decltype(handler)>(handler), 0,
+                                  command_timeout_, priority::normal);
+        },
+        token, cmd);
+  }
+
+  /**
+   * Sends a typed command, with a deadline of its own.
+   *
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, T).
+   * @param cmd Is the command to send.
+   * @param timeout Is how long to wait for the reply, instead of the timeout
+   *set with `set_command_timeout`. The handler is then called with
+   *redis::errc::timeout.
    **/
-  template<class Handler, class... Args>
-  stream& async_write(Handler&& cb, Args... args)
+  template<class CompletionToken, class T, class Rep, class Period>
+  auto async_write(CompletionToken&& token, const typed_command<T>& cmd,
+                   std::chrono::duration<Rep, Period> timeout)
   {
-    size_t current_buffer_size = write_buffer_.size();
+    return async_write(std::forward<CompletionToken>(token), cmd,
+                       priority::normal, timeout);
+  }
 
-    std::ostream os(&write_buffer_);
-    // send as array
-    os << '*' << sizeof...(args) << "\r\n";
+  /**
+   * Sends a typed command in the lane of `p`. It is written before the
+   *commands of the lower priorities not written yet.
+   *
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, T).
+   * @param cmd Is the command to send.
+   * @param p Is the lane of the command.
+   **/
+  template<class CompletionToken, class T>
+  auto async_write(CompletionToken&& token, const typed_command<T>& cmd,
+                   priority p)
+  {
+    return async_write(std::forward<CompletionToken>(token), cmd, p,
+                       command_timeout_);
+  }
 
-    write_to(os, std::forward<Args>(args)...);
+  /**
+   * Sends a typed command in the lane of `p`, with a deadline of its own.
+   *
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code, T).
+   * @param cmd Is the command to send.
+   * @param p Is the lane of the command.
+   * @param timeout Is how long to wait for the reply, 0 to wait forever.
+   **/
+  template<class CompletionToken, class T, class Rep, class Period>
+  auto async_write(CompletionToken&& token, const typed_command<T>& cmd,
+                   priority p, std::chrono::duration<Rep, Period> timeout)
+  {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(boost::system::error_code, T)>(
+        [this](auto&& handler, const typed_command<T>& cmd, priority p,
+               duration timeout)
+        {
+          buffer(p) += cmd.data();
 
-    queue_.emplace_back(write_buffer_.size() - current_buffer_size, cb);
-    if (is_sending_)
-      return *this;
+          enqueue<typed_reply<T>>(std::forward<decltype(handler)>(handler), 0,
+                                  timeout, p);
+        },
+        token, cmd, p,
+        std::chrono::duration_cast<duration>(timeout));
+  }
 
-    next_request();
+  /**
+   * Executes a transaction.
+   *
+   * MULTI, the commands and EXEC are sent in a single write. The +QUEUED
+   *replies are skipped and the operation only completes with the outcome of
+   *EXEC.
+   *
+   * @param tx Is the transaction to execute. It can be reused as soon as the
+   *operation has been initiated.
+   * @param token Is the completion token. The signature is
+   *void(transaction_result).
+   **/
+  template<class CompletionToken>
+  auto async_exec(const transaction& tx, CompletionToken&& token)
+  {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(transaction_result)>(
+        [this](auto&& handler, const transaction& tx)
+        {
+          write_exec(tx);
 
-    return *this;
+          // +OK of MULTI and a +QUEUED per command come before the EXEC reply
+          enqueue<exec_reply>(std::forward<decltype(handler)>(handler),
+                              tx.size() + 1, command_timeout_,
+                              priority::normal);
+        },
+        token, tx);
+  }
+
+  /**
+   * Runs an optimistic transaction, retrying it while the watched keys keep
+   *changing.
+   *
+   * The keys are WATCHed and `prepare` is called with an empty transaction
+   *and a `commit` function. `prepare` can read the keys through this stream,
+   *then fill the transaction and call `commit` once. If a watched key
+   *changed before EXEC the transaction is prepared again, up to
+   *`max_attempts` times.
+   *
+   * WATCH applies to the whole connection: other commands can share the
+   *stream, but only one optimistic transaction should be running on it at a
+   *time.
+   *
+   * @param keys Are the keys to watch.
+   * @param prepare Is the callback that fills the transaction.
+   * @param token Is the completion token, completed with the results of the
+   *last attempt. The signature is void(transaction_result).
+   * @param max_attempts Is the maximum number of times the transaction is
+   *tried.
+   **/
+  template<class CompletionToken>
+  auto async_transaction(const std::vector<std::string>& keys,
+                         prepare_cb prepare, CompletionToken&& token,
+                         size_t max_attempts = 16)
+  {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(transaction_result)>(
+        [this](auto&& handler, const std::vector<std::string>& keys,
+               prepare_cb prepare, size_t max_attempts)
+        {
+          auto state = std::make_shared<optimistic_transaction>();
+
+          state->watch.reserve(keys.size() + 1);
+          state->watch.push_back("WATCH");
+          state->watch.insert(state->watch.end(), keys.begin(), keys.end());
+
+          state->prepare       = std::move(prepare);
+          state->done          = make_op<exec_reply>(
+              std::forward<decltype(handler)>(handler));
+          state->attempts_left = max_attempts > 0 ? max_attempts : 1;
+
+          attempt(std::move(state));
+        },
+        token, keys, std::move(prepare), max_attempts);
   }
 
   // template<typename Topic>
@@ -151,7 +525,7 @@ public:
   **/
   void set_on_stream_closed(basic_stream::on_stream_closed_cb cb)
   {
-    stream_.set_on_stream_closed(cb);
+    on_stream_closed_cb_ = cb;
   }
 
   /**
@@ -161,7 +535,81 @@ public:
   **/
   void set_on_reconnect(basic_stream::on_reconnect_cb cb)
   {
-    stream_.set_on_reconnect(cb);
+    on_reconnect_cb_ = cb;
+  }
+
+  /**
+   * Adds a callback called every time the connection is established, the
+   *first time and after every reconnection.
+   *
+   * Commands sent from the callback are written together with the commands
+   *queued while there was no connection. Unlike `set_on_reconnect`, any
+   *number of callbacks can be added; they are used by the helpers built on
+   *top of the stream.
+   *
+   * @param cb Is the callback to add.
+   **/
+  void add_on_connected(basic_stream::on_reconnect_cb cb)
+  {
+    on_connected_cbs_.push_back(std::move(cb));
+  }
+
+  /**
+   * Records what the stream does into `m`: counters, the commands waiting to
+   *be written or for their reply and the latency of every command. The same
+   *metrics can be set on several streams.
+   *
+   * Only the commands sent after the call are measured. Transactions are
+   *recorded as MULTI.
+   *
+   * @param m Is where to record, nullptr stops recording.
+   **/
+  void set_metrics(std::shared_ptr<metrics> m);
+
+  /**
+   * Sets a deadline on every command sent from now on. A command whose reply
+   *hasn't arrived in time completes with a timeout error: redis::errc::timeout
+   *for the typed commands, an "ERR command timed out" error otherwise. The
+   *command keeps its place in the stream, its late reply is read and
+   *discarded.
+   *
+   * Commands can also be cancelled through the cancellation slot of their
+   *completion handler, with Boost 1.77 and later. They then complete with
+   *boost::asio::error::operation_aborted. The terminal and partial
+   *cancellations are supported: the command may still run on the server. The
+   *signal must be emitted from the thread running the stream.
+   *
+   * @param timeout Is how long to wait for each reply, 0 to wait forever.
+   * @param recycle_after Is how many timed out commands may wait for their
+   *reply at once before the connection is dropped and made again, failing
+   *the commands in flight. 0 keeps the connection.
+   **/
+  void set_command_timeout(duration timeout, size_t recycle_after = 0)
+  {
+    command_timeout_ = timeout;
+    recycle_after_   = recycle_after;
+  }
+
+  /**
+   * Limits how many commands of a lane wait for their reply at once. The
+   *others wait to be written, letting the commands of the lower priorities
+   *through, e.g. a limit of 1 on priority::low keeps a batch job from
+   *filling the connection.
+   *
+   * Each lane has its own queue: the commands of a lane are written in the
+   *order they were sent, before the commands of the lower priorities not
+   *written yet. A command already written can't be overtaken, a command
+   *that mustn't wait behind large ones needs a stream of its own.
+   *
+   * @param p Is the lane to limit.
+   * @param max_in_flight Is the most commands waiting for their reply, 0 for
+   *no limit.
+   **/
+  void set_lane_limit(priority p, size_t max_in_flight)
+  {
+    lanes_[static_cast<size_t>(p)].limit = max_in_flight;
+
+    write();
   }
 
   /**
@@ -177,6 +625,8 @@ public:
   * 
   * Note that this call will also disable reconnection. If the user calls `close` with
   * the intention to reconnect the connection bear in mind to call async_connect afterwards.
+  * The stream may be destroyed right after, even with a read still waiting
+  * for the late reply of a command timed out.
   **/
   inline void close()
   {
@@ -184,128 +634,520 @@ public:
   }
 
 private:
-  // we need to stop forwarding at some point
-  void write_to(std::ostream& os)
+  // a pending completion. The handler keeps its own type and is allocated
+  // with its associated allocator. The reply is decoded by the op itself,
+  // into the type of its completion signature.
+  struct op
   {
-  }
+    // decodes the reply at the start of `s`, returns the bytes used or 0 if
+    // the reply isn't complete yet. Both the parser and the scanner keep
+    // their progress between the calls on the same reply.
+    virtual size_t parse(redis::parser& parser, reply_scanner& scanner,
+                         const char* s, size_t n) = 0;
+
+    // replaces the reply parsed if it's an error
+    virtual void replace_error(const redis::types::error& e) = 0;
+
+    // sets the reply to the one given
+    virtual void assign(any_type reply) = 0;
+
+    // sets the reply to a connection lost error
+    virtual void lost() = 0;
+
+    // sets the reply to the error given, the reply won't be waited for
+    virtual void abort(boost::system::error_code ec) = 0;
+
+    // cancels the command through `s` when the handler's cancellation slot
+    // is emitted
+    virtual void bind_cancellation(stream* s) = 0;
+
+    // invokes the handler with the reply and releases the op
+    virtual void complete() = 0;
 
-  template<class... Args>
-  void write_to(std::ostream& os, const std::string& s, Args... args)
+    // releases the op without invoking the handler
+    virtual void destroy() = 0;
+
+    // the number of the command on its stream
+    uint64_t id = 0;
+    // the connection traced, see trace::event
+    const void* trace_connection = nullptr;
+    // why the reply won't be parsed, set by lost and abort
+    boost::system::error_code failure;
+
+  protected:
+    ~op() = default;
+  };
+
+  // the reply as an any_type
+  struct any_reply
   {
-    redis::types::string rs(s);
-    rs.serialize(os);
+    any_type value;
 
-    write_to(os, std::forward<Args>(args)...);
-  }
+    size_t parse(redis::parser& parser, reply_scanner&, const char* s,
+                 size_t n)
+    {
+      size_t bytes_parsed = parser.parse(s, n);
+      if (parser.need_more() || bytes_parsed == 0)
+        return 0;
+
+      value = std::move(*parser);
+      return bytes_parsed;
+    }
+
+    void replace_error(const redis::types::error& e)
+    {
+      if (boost::variant2::holds_alternative<redis::types::error>(value))
+        value = e;
+    }
+
+    void assign(any_type reply)
+    {
+      value = std::move(reply);
+    }
+
+    void lost()
+    {
+      redis::types::error e;
+      e = "ERR connection lost";
+
+      value = std::move(e);
+    }
+
+    void abort(boost::system::error_code ec)
+    {
+      redis::types::error e;
+      e = "ERR " + ec.message();
+
+      value = std::move(e);
+    }
 
-  // double are strings
-  template<class... Args>
-  void write_to(std::ostream& os, double s, Args... args)
+    template<class Handler>
+    void invoke(Handler& handler)
+    {
+      std::move(handler)(std::move(value));
+    }
+  };
+
+  // the EXEC reply of a transaction
+  struct exec_reply : any_reply
   {
-    redis::types::string rs(s);
-    rs.serialize(os);
+    template<class Handler>
+    void invoke(Handler& handler)
+    {
+      std::move(handler)(transaction_result(std::move(value)));
+    }
+  };
 
-    write_to(os, std::forward<Args>(args)...);
-  }
+  // the reply decoded into a T, without building any any_type
+  template<class T>
+  struct typed_reply
+  {
+    boost::system::error_code ec;
+    T value;
+
+    size_t parse(redis::parser&, reply_scanner& scanner, const char* s,
+                 size_t n)
+    {
+      // decoded once complete, instead of again from the start on every read
+      size_t size = scanner.scan(s, n);
+      if (size == 0)
+        return 0;
+
+      resp_reader r(s, size);
+      if (!decode_reply(r, value, ec))
+        return 0;
+
+      return size;
+    }
+
+    void replace_error(const redis::types::error&)
+    {
+    }
+
+    void assign(any_type)
+    {
+      ec = errc::unexpected_reply;
+    }
+
+    void lost()
+    {
+      ec    = errc::connection_lost;
+      value = T{};
+    }
+
+    void abort(boost::system::error_code e)
+    {
+      ec    = e;
+      value = T{};
+    }
 
-  template<class... Args>
-  void write_to(std::ostream& os, const redis::types::string& rs, Args... args)
+    template<class Handler>
+    void invoke(Handler& handler)
+    {
+      std::move(handler)(ec, std::move(value));
+    }
+  };
+
+  template<class Handler, class Reply>
+  struct handler_op final : op
   {
-    rs.serialize(os);
-    write_to(os, std::forward<Args>(args)...);
-  }
+    using executor_type = typename boost::asio::associated_executor<
+        Handler, basic_stream::asio_stream::executor_type>::type;
+    using allocator_type = typename std::allocator_traits<
+        boost::asio::associated_allocator_t<Handler>>::template rebind_alloc<
+        handler_op>;
+
+    Handler handler;
+    boost::asio::executor_work_guard<executor_type> work;
+    Reply reply;
+
+    template<class H>
+    handler_op(H&& h, basic_stream::asio_stream::executor_type ex)
+        : handler(std::forward<H>(h))
+        , work(boost::asio::get_associated_executor(handler, ex))
+    {
+    }
+
+    size_t parse(redis::parser& parser, reply_scanner& scanner, const char* s,
+                 size_t n) override
+    {
+      return reply.parse(parser, scanner, s, n);
+    }
+
+    void replace_error(const redis::types::error& e) override
+    {
+      reply.replace_error(e);
+    }
+
+    void assign(any_type r) override
+    {
+      reply.assign(std::move(r));
+    }
 
-  template<class... Args>
-  void write_to(std::ostream& os, const redis::types::vector& vs, Args... args)
+    void lost() override
+    {
+      failure = errc::connection_lost;
+      reply.lost();
+    }
+
+    void abort(boost::system::error_code ec) override
+    {
+      failure = ec;
+      reply.abort(ec);
+    }
+
+#ifdef REDIS_CLIENT_HAS_CANCELLATION
+    struct cancellation
+    {
+      stream* self;
+      uint64_t id;
+
+      void operator()(boost::asio::cancellation_type type)
+      {
+        using boost::asio::cancellation_type;
+
+        if ((type & (cancellation_type::terminal |
+                     cancellation_type::partial)) != cancellation_type::none)
+          self->cancel(id);
+      }
+    };
+
+    void bind_cancellation(stream* s) override
+    {
+      auto slot = boost::asio::get_associated_cancellation_slot(handler);
+      if (slot.is_connected())
+        slot.template emplace<cancellation>(cancellation{s, id});
+    }
+#else
+    void bind_cancellation(stream*) override
+    {
+    }
+#endif
+
+    void complete() override
+    {
+      clear_cancellation();
+
+      // the memory is released before the upcall so the handler can reuse it
+      Handler h(std::move(handler));
+      auto w(std::move(work));
+      Reply r(std::move(reply));
+      auto connection = trace_connection;
+      auto id         = this->id;
+      auto failure    = this->failure;
+
+      release();
+
+      boost::asio::dispatch(
+          w.get_executor(),
+          bind_handler(std::move(h),
+                       [r = std::move(r), connection, id,
+                        failure](Handler& h) mutable
+                       {
+                         r.invoke(h);
+
+                         trace::emit(
+                             [&]
+                             {
+                               trace::event e{
+                                   trace::event_type::handler_completed,
+                                   connection, id, id};
+                               e.ec = failure;
+                               return e;
+                             });
+                       }));
+    }
+
+    void destroy() override
+    {
+      clear_cancellation();
+      release();
+    }
+
+    // the slot must not outlive the operation
+    void clear_cancellation()
+    {
+#ifdef REDIS_CLIENT_HAS_CANCELLATION
+      auto slot = boost::asio::get_associated_cancellation_slot(handler);
+      if (slot.is_connected())
+        slot.clear();
+#endif
+    }
+
+    void release()
+    {
+      allocator_type a(boost::asio::get_associated_allocator(handler));
+
+      std::allocator_traits<allocator_type>::destroy(a, this);
+      std::allocator_traits<allocator_type>::deallocate(a, this, 1);
+    }
+  };
+
+  template<class Reply, class Handler>
+  op* make_op(Handler&& handler)
   {
-    vs.serialize(os);
-    write_to(os, std::forward<Args>(args)...);
+    using op_type = handler_op<std::decay_t<Handler>, Reply>;
+    using traits  = std::allocator_traits<typename op_type::allocator_type>;
+
+    typename op_type::allocator_type a(
+        boost::asio::get_associated_allocator(handler));
+
+    auto p = traits::allocate(a, 1);
+    try
+    {
+      traits::construct(a, p, std::forward<Handler>(handler), get_executor());
+    }
+    catch (...)
+    {
+      traits::deallocate(a, p, 1);
+      throw;
+    }
+
+    return p;
   }
 
-  template<class T, class... Args,
-           typename = std::enable_if_t<std::is_integral_v<T>>>
-  void write_to(std::ostream& os, T n, Args... args)
+  template<class Reply, class Handler>
+  void enqueue(Handler&& handler, size_t skip, duration timeout, priority p)
   {
-    redis::types::integer ri(n);
-    ri.serialize(os);
+    auto& l = lanes_[static_cast<size_t>(p)];
+
+    l.requests.push_back({make_op<Reply>(std::forward<Handler>(handler)),
+                          skip, {}, nullptr, {}, ++last_id_,
+                          std::chrono::steady_clock::time_point::max(),
+                          l.buffer.size() - l.command_start, p});
+
+    auto& req       = l.requests.back();
+    req.handler->id = req.id;
+    req.handler->bind_cancellation(this);
+
+    if (timeout.count() > 0)
+      set_deadline(req, timeout);
+    if (metrics_)
+      measure(req, l);
+    if constexpr (trace::enabled)
+      trace_enqueued(req, l);
+    l.command_start = l.buffer.size();
 
-    write_to(os, std::forward<Args>(args)...);
+    write();
   }
 
-  template<class... Args>
-  void write_to(std::ostream& os, const redis::types::integer& ri, Args... args)
+  struct request
   {
-    ri.serialize(os);
-    write_to(os, std::forward<Args>(args)...);
-  }
+    // nullptr once timed out or cancelled, the reply is then discarded
+    op* handler;
+    // replies to skip before the one delivered to handler
+    size_t skip;
+    // first error among the skipped replies
+    redis::types::error error;
+    // where the latency goes, nullptr when not measured
+    metrics::command_metrics* measured;
+    std::chrono::steady_clock::time_point enqueued;
+    // numbers the commands, in the order of the queue
+    uint64_t id;
+    // time_point::max() when the command has none
+    std::chrono::steady_clock::time_point deadline;
+    // the size of the command encoded
+    size_t bytes;
+    priority prio;
+  };
 
-  void next_request()
+  // the commands of a priority not written yet
+  struct lane
   {
-    is_sending_ = true;
+    std::string buffer;
+    std::deque<request> requests;
+    // where the last command enqueued starts in buffer
+    size_t command_start = 0;
+    // commands written waiting for their reply, and the most allowed
+    size_t in_flight = 0;
+    size_t limit     = 0;
+  };
 
-    stream_.async_write(write_buffer_, [this](auto&& ec, size_t bytes_written)
-                        { on_write(ec, bytes_written); });
+  std::string& buffer(priority p)
+  {
+    return lanes_[static_cast<size_t>(p)].buffer;
   }
 
-  void on_write(boost::system::error_code const& ec, size_t written)
+  // moves the commands of `l` allowed to go to sending_buffer_ and queue_
+  void take(lane& l);
+
+  // the request at the front of queue_ got its reply or lost it
+  void pop_front();
+
+  // emits `type` for the `count` requests of queue_ from `first`, grouping
+  // the consecutive ids
+  void trace_write(trace::event_type type, size_t first, size_t count,
+                   boost::system::error_code ec);
+
+  void set_deadline(request& req, duration timeout);
+
+  // makes the timer wait for `deadline` if it is the earliest
+  void arm_timer(std::chrono::steady_clock::time_point deadline);
+  void on_timer();
+
+  // completes the handler of `req` with `ec` and discards its reply.
+  // `written` tells whether `req` is in queue_ rather than in a lane.
+  void expire(request& req, boost::system::error_code ec, bool written);
+
+  // cancels the command numbered `id`, if still waiting for its reply
+  void cancel(uint64_t id);
+
+  // reconnects once recycle_after_ commands timed out
+  void recycle_if_stuck();
+
+  // the name of the command at the command_start of `l`
+  std::string_view command_name(const lane& l) const;
+
+  // starts measuring the command at the command_start of `l`
+  void measure(request& req, const lane& l);
+
+  void trace_enqueued(request& req, const lane& l);
+
+  struct optimistic_transaction
   {
-    if (ec)
+    std::vector<std::string> watch;
+    prepare_cb prepare;
+    op* done;
+    size_t attempts_left;
+    transaction tx;
+
+    ~optimistic_transaction()
     {
-      return;
+      if (done != nullptr)
+        done->destroy();
     }
+  };
 
-    stream_.async_read_some(read_buffer_.prepare(DEFAULT_READ_SIZE),
-                            [this, written](auto&& ec, size_t bytes_read)
-                            {
-                              if (!ec)
-                                write_buffer_.consume(written);
-                              on_read(ec, bytes_read);
-                            });
-  }
+  void attempt(std::shared_ptr<optimistic_transaction> state);
+
+  // completes `state` with the last result
+  void finish(std::shared_ptr<optimistic_transaction> state, any_type reply);
 
-  void on_read(boost::system::error_code const& ec, size_t bytes_read)
+  // connects the underlying stream, then flushes the queued commands
+  struct connect_op
   {
-    if (ec)
+    stream* self_;
+    std::string host;
+    // empty when host is `host:port`
+    std::string port;
+    bool started;
+
+    template<class Self>
+    void operator()(Self& self, boost::system::error_code ec = {})
     {
-      return;
-    }
+      if (!started)
+      {
+        started = true;
 
-    read_buffer_.commit(bytes_read);
+        if (port.empty())
+          return self_->stream_.async_connect(host, std::move(self));
+        return self_->stream_.async_connect(host, port, std::move(self));
+      }
 
-    size_t bytes_parsed = parser_.parse(
-        (const char*) read_buffer_.data().data(), read_buffer_.size());
-    if (parser_.need_more())
-    {
-      // TODO: handle partial reads
-      stream_.async_read_some(read_buffer_.prepare(DEFAULT_READ_SIZE),
-                              [this](auto&& ec, size_t bytes_read)
-                              { on_read(ec, bytes_read); });
-      return;
+      if (!ec)
+        self_->on_connected();
+
+      self.complete(ec);
     }
+  };
 
-    read_buffer_.consume(bytes_parsed);
+  // encodes the transaction in the normal lane
+  void write_exec(const transaction& tx);
 
-    auto& e = queue_.front();
-    e.second(*parser_);
-    queue_.pop_front();
+  void on_connected();
 
-    if ((is_sending_ = !queue_.empty()))
-      next_request();
-  }
+  void on_stream_closed(boost::system::error_code ec);
+
+  void write();
+  // writes the requests of queue_ from `first`, put in sending_buffer_
+  void send(size_t first);
+  void on_write();
+
+  void read();
+  void on_read(boost::system::error_code const& ec, size_t bytes_read);
 
 private:
   redis::basic_stream stream_;
 
-  bool is_sending_;
+  basic_stream::on_stream_closed_cb on_stream_closed_cb_;
+  basic_stream::on_reconnect_cb on_reconnect_cb_;
+  std::vector<basic_stream::on_reconnect_cb> on_connected_cbs_;
+
+  bool is_connected_;
+  bool is_writing_;
+  bool is_reading_;
   redis::parser parser_;
+  // how far the typed reply being read was scanned
+  reply_scanner scanner_;
 
-  // write buffer
-  boost::asio::streambuf write_buffer_;
+  // commands waiting to be written, by priority
+  std::array<lane, 3> lanes_;
+  // commands being written, the last `sending_` of queue_
+  std::string sending_buffer_;
+  size_t sending_;
   // read buffer
   boost::asio::streambuf read_buffer_;
+  // bytes still missing from a bulk string cut short at the end of
+  // read_buffer_, read in one go instead of DEFAULT_READ_SIZE at a time
+  size_t missing_;
+
+  // handlers of the commands written, in the order the replies will arrive
+  std::deque<request> queue_;
+  // the id of the last command enqueued, and of the last one whose reply
+  // started to be read
+  uint64_t last_id_;
+  uint64_t reading_id_;
+
+  std::shared_ptr<metrics> metrics_;
 
-  // readed bytes aka size of the content of read_buffer_
-  std::list<std::pair<size_t, handler>> queue_;
+  // a single timer for the earliest deadline of the queue and the lanes
+  boost::asio::steady_timer timer_;
+  std::chrono::steady_clock::time_point timer_expiry_;
+  duration command_timeout_;
+  size_t recycle_after_;
+  // requests of queue_ timed out or cancelled, waiting for their reply.
+  // Those still in a lane only count once written.
+  size_t stale_;
 };
 }  // namespace redis
 
@@ -0,0 +1,408 @@
+#ifndef REDIS_STREAM_CONSUMER_H
+#define REDIS_STREAM_CONSUMER_H
+
+#include <redis/basic_stream.hpp>
+#include <redis/resp_reader.hpp>
+#include <redis/types.hpp>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifndef DEFAULT_CONSUMER_READ_SIZE
+#define DEFAULT_CONSUMER_READ_SIZE 65536
+#endif
+
+namespace redis
+{
+/**
+ * An entry read from a Redis stream.
+ *
+ * All the views point into the connection's read buffer and are only valid
+ * until the batch callback returns.
+ **/
+struct stream_entry
+{
+  using field = std::pair<std::string_view, std::string_view>;
+
+  std::string_view stream;
+  std::string_view id;
+
+  const field* fields;
+  size_t size;
+
+  const field* begin() const
+  {
+    return fields;
+  }
+
+  const field* end() const
+  {
+    return fields + size;
+  }
+
+  /**
+   * Returns the value of `name` or an empty view if the entry doesn't have
+   *it.
+   **/
+  std::string_view operator[](std::string_view name) const
+  {
+    for (auto&& f : *this)
+    {
+      if (f.first == name)
+        return f.second;
+    }
+
+    return {};
+  }
+};
+
+/**
+ * The entries returned by a single XREADGROUP call.
+ *
+ * The batch is reused between calls, so once it has grown to the usual batch
+ * size reading entries doesn't allocate.
+ **/
+class stream_batch
+{
+public:
+  using const_iterator = std::vector<stream_entry>::const_iterator;
+
+  const_iterator begin() const
+  {
+    return entries_.begin();
+  }
+
+  const_iterator end() const
+  {
+    return entries_.end();
+  }
+
+  size_t size() const
+  {
+    return entries_.size();
+  }
+
+  bool empty() const
+  {
+    return entries_.empty();
+  }
+
+  const stream_entry& operator[](size_t pos) const
+  {
+    return entries_[pos];
+  }
+
+private:
+  friend class stream_consumer;
+
+  void clear();
+
+  // parses an XREADGROUP reply, returns false if more data is needed
+  bool parse(resp_reader& r);
+
+private:
+  std::vector<stream_entry> entries_;
+  std::vector<stream_entry::field> fields_;
+
+  // set when the reply was an error
+  std::string_view error_;
+};
+
+/**
+ * stream_consumer reads Redis streams as part of a consumer group.
+ *
+ * It owns its connection, so the blocking XREADGROUP calls don't hold up
+ * the commands of any other stream. Pending acknowledgements are sent in
+ * the same write as the next XREADGROUP. After connecting and after every
+ * reconnection the consumer first reads back the entries that were
+ * delivered to it but never acknowledged.
+ **/
+class stream_consumer
+{
+public:
+  using batch_cb = std::function<void(const stream_batch&)>;
+  using error_cb = std::function<void(const redis::types::error&)>;
+
+public:
+  stream_consumer()                  = delete;
+  stream_consumer(stream_consumer&)  = delete;
+  stream_consumer(stream_consumer&&) = delete;
+
+  /**
+   * Should always be initialised with the io_context.
+   **/
+  stream_consumer(boost::asio::io_context& ioc);
+
+  /**
+   * Returns the io_context passed on the constructor.
+   **/
+  basic_stream::asio_stream::executor_type get_executor();
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * Note that this function will throw an exception if any
+   *boost::system::error_code error is encountered.
+   *
+   * @param hostport Should be a valid host and port in the following format
+   * `host:port`, or the path of a unix domain socket as `unix:///path`.
+   **/
+  void connect(const std::string& hostport);
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * This function will not throw any exception.
+   *
+   * @param hostport Should be a valid host and port in the following format
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
+   * @param ec Is a valid reference to a boost::system::error_code that will be
+   *set by the function if any error happens.
+   **/
+  void connect(const std::string& hostport,
+               boost::system::error_code& ec) noexcept;
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * Note that this function will throw an exception if any
+   *boost::system::error_code error is encountered.
+   *
+   * @param host Is a valid hostname or IP.
+   * @param port Is a valid port as a string.
+   **/
+  void connect(const std::string& host, const std::string& port);
+
+  /**
+   * Establishes a connection to a redis instance.
+   *
+   * @param host Is a valid hostname or IP.
+   * @param port Is a valid port as a string.
+   * @param ec Is a valid reference to a boost::system::error_code that will be
+   *set by the function if any error happens.
+   **/
+  void connect(const std::string& host, const std::string& port,
+               boost::system::error_code& ec) noexcept;
+
+  /**
+   * Makes the connections use TLS, with the session resumed on every
+   *reconnection. Must be called before connecting.
+   *
+   * @param ctx Is the context the connections are made with. It must
+   *outlive the stream.
+   * @param options Are the server name, ciphers and ALPN protocols.
+   **/
+  void set_tls(boost::asio::ssl::context& ctx,
+               tls_options options = {})
+  {
+    stream_.set_tls(ctx, std::move(options));
+  }
+
+  /**
+   * Sets the commands sent first on every connection, the reconnections
+   *included, e.g. AUTH and SELECT. Reading resumes only once they all
+   *succeeded. A reply with an error fails the connection with
+   *redis::errc::handshake_failed, see basic_stream::set_handshake.
+   *
+   * @param options Are the credentials, client name, database and other
+   *commands to send.
+   **/
+  void set_handshake(handshake_options options)
+  {
+    stream_.set_handshake(std::move(options));
+  }
+
+  /**
+   * Returns the error the server replied to the last handshake, empty if it
+   *succeeded.
+   **/
+  const std::string& handshake_error() const
+  {
+    return stream_.handshake_error();
+  }
+
+  /**
+   * Establishes a connection to a redis instance asynchronously.
+   *
+   * This function will return immediately.
+   *
+   * @param hostport Should be a valid host and port in the following format
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
+   * @param cb Is the callback that will get called when the operation ends.
+   **/
+  void async_connect(const std::string& hostport,
+                     basic_stream::on_connect_cb cb) noexcept;
+
+  /**
+   * Establishes a connection to a redis instance asynchronously.
+   *
+   * This function will return immediately.
+   *
+   * @param host Is a valid hostname or IP.
+   * @param port Is a valid port as a string.
+   * @param cb Is the callback that will get called when the operation ends.
+   **/
+  void async_connect(const std::string& host, const std::string& port,
+                     basic_stream::on_connect_cb cb) noexcept;
+
+  /**
+   * Sets the maximum number of entries read per XREADGROUP (COUNT).
+   * Defaults to 100.
+   **/
+  void set_batch_size(size_t count)
+  {
+    batch_size_ = count;
+  }
+
+  /**
+   * Sets how long each XREADGROUP blocks waiting for new entries (BLOCK).
+   * Defaults to 5 seconds.
+   **/
+  void set_block(std::chrono::milliseconds timeout)
+  {
+    block_ = timeout;
+  }
+
+  /**
+   * When enabled every entry is acknowledged once the batch callback returns.
+   * Disabled by default.
+   **/
+  void set_auto_ack(bool auto_ack)
+  {
+    auto_ack_ = auto_ack;
+  }
+
+  /**
+   * When enabled (the default) the group is created on every stream with
+   *`XGROUP CREATE ... $ MKSTREAM` before reading. Existing groups are left
+   *untouched.
+   **/
+  void set_create_group(bool create)
+  {
+    create_group_ = create;
+  }
+
+  /**
+   * Sets a callback for the errors returned by the server.
+   **/
+  void set_on_error(error_cb cb)
+  {
+    on_error_cb_ = cb;
+  }
+
+  /**
+   * Starts reading the streams. Should only be called once, after
+   *connecting.
+   *
+   * @param group Is the name of the consumer group.
+   * @param consumer Is the name of this consumer inside the group.
+   * @param streams Are the keys of the streams to read.
+   * @param cb Is the callback that will get called with every non empty
+   *batch.
+   **/
+  void consume(const std::string& group, const std::string& consumer,
+               const std::vector<std::string>& streams, batch_cb cb);
+
+  /**
+   * Acknowledges an entry. The XACK is sent with the next XREADGROUP.
+   **/
+  void ack(const stream_entry& entry);
+
+  /**
+   * Acknowledges an entry. The XACK is sent with the next XREADGROUP.
+   *
+   * @param stream Is the key of the stream.
+   * @param id Is the id of the entry.
+   **/
+  void ack(std::string_view stream, std::string_view id);
+
+  /**
+   * Stops reading once the current XREADGROUP returns. Pending
+   *acknowledgements are still sent.
+   **/
+  void stop();
+
+  /**
+   * Returns whether the socket is open or not.
+   **/
+  operator bool()
+  {
+    return !!stream_;
+  }
+
+  /**
+   * Closes the connection and the underlying socket.
+   *
+   * Acknowledgements that weren't sent yet are lost and the entries will be
+   *delivered again the next time the consumer starts.
+   **/
+  inline void close()
+  {
+    stream_.close();
+  }
+
+private:
+  enum class reply_kind
+  {
+    group,
+    ack,
+    read
+  };
+
+  struct stream_state
+  {
+    std::string key;
+    // ">" for new entries, anything else while reading back pending entries
+    std::string id;
+
+    // encoded ids waiting for the next XACK
+    std::string acks;
+    size_t ack_count;
+  };
+
+  stream_state* find(std::string_view key);
+
+  void restart();
+  void round(bool read_entries);
+  void on_batch();
+
+  void write();
+  void read();
+  void on_read(boost::system::error_code const& ec, size_t read_bytes);
+
+  void report(std::string_view error);
+
+private:
+  redis::basic_stream stream_;
+  boost::asio::steady_timer retry_timer_;
+
+  std::string group_;
+  std::string consumer_;
+  std::vector<stream_state> streams_;
+
+  batch_cb on_batch_cb_;
+  error_cb on_error_cb_;
+
+  size_t batch_size_;
+  std::chrono::milliseconds block_;
+  bool auto_ack_;
+  bool create_group_;
+
+  stream_batch batch_;
+  std::deque<reply_kind> expected_;
+
+  boost::asio::streambuf read_buffer_;
+  std::string write_buffer_;
+  std::string sending_buffer_;
+
+  bool is_running_;
+  bool is_reading_;
+  bool is_writing_;
+};
+}  // namespace redis
+
+#endif
@@ -3,8 +3,11 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <redis/basic_stream.hpp>
+#include <redis/command.hpp>
+#include <redis/message_workers.hpp>
 #include <redis/parser.hpp>
 #include <redis/types.hpp>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -18,7 +21,7 @@ namespace redis
 class subscribed_stream
 {
 public:
-  using message_cb = std::function<void(std::string, std::string)>;
+  using message_cb = message_workers::message_cb;
 
 private:
   struct message_parser
@@ -32,6 +35,13 @@ private:
       return !channel.empty() && !message.empty();
     }
 
+    void reset()
+    {
+      channel.clear();
+      target_channel.clear();
+      message.clear();
+    }
+
     // the array it's called next
     void operator()(const redis::types::vector& v)
     {
@@ -89,7 +99,7 @@ public:
    *boost::system::error_code error is encountered.
    *
    * @param hostport Should be a valid host and port in the following format
-   * `host:port`.
+   * `host:port`, or the path of a unix domain socket as `unix:///path`.
    **/
   void connect(const std::string& hostport);
 
@@ -99,7 +109,7 @@ public:
    * This function will not throw any exception.
    *
    * @param hostport Should be a valid host and port in the following format
-   *`host:port`.
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
    * @param ec Is a valid reference to a boost::system::error_code that will be
    *set by the function if any error happens.
    **/
@@ -128,17 +138,60 @@ public:
   void connect(const std::string& host, const std::string& port,
                boost::system::error_code& ec) noexcept;
 
+  /**
+   * Makes the connections use TLS, with the session resumed on every
+   *reconnection. Must be called before connecting.
+   *
+   * @param ctx Is the context the connections are made with. It must
+   *outlive the stream.
+   * @param options Are the server name, ciphers and ALPN protocols.
+   **/
+  void set_tls(boost::asio::ssl::context& ctx,
+               tls_options options = {})
+  {
+    stream_.set_tls(ctx, std::move(options));
+  }
+
+  /**
+   * Sets the commands sent first on every connection, the reconnections
+   *included, e.g. AUTH. A reconnection subscribes again only once they all
+   *succeeded. A reply with an error fails the connection with
+   *redis::errc::handshake_failed, see basic_stream::set_handshake.
+   *
+   * @param options Are the credentials, client name and other commands to
+   *send. The database doesn't matter to the subscriptions.
+   **/
+  void set_handshake(handshake_options options)
+  {
+    stream_.set_handshake(std::move(options));
+  }
+
+  /**
+   * Returns the error the server replied to the last handshake, empty if it
+   *succeeded.
+   **/
+  const std::string& handshake_error() const
+  {
+    return stream_.handshake_error();
+  }
+
   /**
    * Establishes a connection to a redis instance asynchronously.
    *
    * This function will return immediately.
    *
    * @param hostport Should be a valid host and port in the following format
-   *`host:port`.
-   * @param cb Is the callback that will get called when the operation ends.
+   *`host:port`, or the path of a unix domain socket as `unix:///path`.
+   * @param token Is the completion token, a callback or e.g.
+   *`boost::asio::use_awaitable`. The signature is
+   *void(boost::system::error_code).
    **/
-  void async_connect(const std::string& hostport,
-                     basic_stream::on_connect_cb cb) noexcept;
+  template<class CompletionToken>
+  auto async_connect(const std::string& hostport, CompletionToken&& token)
+  {
+    return stream_.async_connect(hostport,
+                                 std::forward<CompletionToken>(token));
+  }
 
   /**
    * Establishes a connection to a redis instance asynchronously.
@@ -147,19 +200,54 @@ public:
    *
    * @param host Is a valid hostname or IP.
    * @param port Is a valid port as a string.
-   * @param cb Is the callback that will get called when the operation ends.
+   * @param token Is the completion token. The signature is
+   *void(boost::system::error_code).
+   **/
+  template<class CompletionToken>
+  auto async_connect(const std::string& host, const std::string& port,
+                     CompletionToken&& token)
+  {
+    return stream_.async_connect(host, port,
+                                 std::forward<CompletionToken>(token));
+  }
+
+  /**
+   * Runs the message callbacks on `threads` worker threads instead of the
+   * thread running the io_context.
+   *
+   * Each subscription is bound to one worker, so the messages of a
+   * subscription are always handled in order. Must be called before
+   * `io_context::run` or from the thread running it.
+   *
+   * @param threads Is the number of worker threads. 0 goes back to invoking
+   *the callbacks on the io_context.
+   * @param queue_size Is the number of messages each worker can have queued
+   *before reading from the socket is paused.
    **/
-  void async_connect(const std::string& host, const std::string& port,
-                     basic_stream::on_connect_cb cb) noexcept;
+  void set_workers(size_t threads,
+                   size_t queue_size = DEFAULT_WORKER_QUEUE_SIZE);
 
   /**
    * Subscribes to a topic.
    *
+   * When workers are enabled the subscription is bound to the worker picked
+   * by hashing the topic.
+   *
    * @param topic Is the topic to subscribe to.
    * @param cb Is the callback that will get called after every message.
    **/
   void subscribe(const std::string& topic, message_cb cb);
 
+  /**
+   * Subscribes to a topic binding it to a specific worker.
+   *
+   * @param topic Is the topic to subscribe to.
+   * @param worker Is the worker that will run `cb`, taken modulo the number
+   *of workers.
+   * @param cb Is the callback that will get called after every message.
+   **/
+  void subscribe(const std::string& topic, size_t worker, message_cb cb);
+
   /**
    * Subscribe to a topic using a RegEX.
    *
@@ -170,6 +258,16 @@ public:
    **/
   void psubscribe(const std::string& topic, message_cb cb);
 
+  /**
+   * Subscribe to a topic using a RegEX binding it to a specific worker.
+   *
+   * @param topic Is the topic to subscribe to.
+   * @param worker Is the worker that will run `cb`, taken modulo the number
+   *of workers.
+   * @param cb Is the callback that will get called after every message.
+   **/
+  void psubscribe(const std::string& topic, size_t worker, message_cb cb);
+
   /**
    * Unsubscribe from a topic.
    *
@@ -204,7 +302,7 @@ private:
                   basic_stream::on_connect_cb cb);
 
   void subscribe(std::string_view command, const std::string& topic,
-                 message_cb);
+                 size_t worker, message_cb);
 
   void on_subscribed(boost::system::error_code const& ec, size_t bytes_written);
 
@@ -213,6 +311,8 @@ private:
 
   void on_read(boost::system::error_code const& ec, size_t read_bytes);
 
+  void dispatch();
+
   void resubscribe();
 
 private:
@@ -222,17 +322,32 @@ private:
     regex
   };
 
+  struct subscription
+  {
+    std::shared_ptr<const message_cb> cb;
+    // worker index or hash of the topic
+    size_t worker;
+  };
+
 private:
   redis::basic_stream stream_;
   redis::parser parser_;
 
   message_parser message_parser_;
 
-  std::unordered_map<std::string, message_cb> subscriptions_;
+  std::unordered_map<std::string, subscription> subscriptions_;
   std::unordered_map<std::string, subscription_type> subscription_meta_;
 
   boost::asio::streambuf read_buffer_;
-  boost::asio::streambuf write_buffer_;
+  // bytes still missing from a bulk string cut short at the end of
+  // read_buffer_, e.g. a large message
+  size_t missing_;
+  // commands waiting to be written
+  std::string write_buffer_;
+  // commands being written
+  std::string sending_buffer_;
+
+  std::unique_ptr<message_workers> workers_;
 
   bool is_reading_;
   bool is_writing_;
@@ -0,0 +1,111 @@
+#ifndef REDIS_TRACING_H
+#define REDIS_TRACING_H
+
+#include <boost/system/error_code.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+/**
+ * Tracing of the life of every command, for attributing its latency to the
+ *queueing, the network and the handler.
+ *
+ * The events are only emitted when the library is built with
+ *REDIS_CLIENT_TRACING defined (the CMake option of the same name). Without
+ *it the calls are discarded at compile time and cost nothing.
+ **/
+namespace redis::trace
+{
+#ifdef REDIS_CLIENT_TRACING
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class event_type
+{
+  // async_write was called, `name` is set
+  enqueued,
+  // the commands from `first` to `last` are being written, `bytes` is set.
+  // A write mixing priorities is reported in several events.
+  write_started,
+  // the write of the commands from `first` to `last` is done, `bytes` and
+  // `ec` are set
+  write_completed,
+  // the first bytes of the reply to `first` were read
+  first_byte,
+  // the reply to `first` was parsed, `error_reply` is set
+  parsed,
+  // the handler of `first` returned, or was posted to its own executor and
+  // returned there. `ec` tells why if it completed without a reply: the
+  // connection lost, a timeout or a cancellation.
+  handler_completed,
+  // the connection was established, the first time or again
+  connected,
+  // the connection was lost, `ec` is set. The commands in flight complete
+  // without a parsed event.
+  disconnected
+};
+
+struct event
+{
+  event_type type;
+  // the connection, the same for all the events of a stream
+  const void* connection = nullptr;
+  // the commands concerned, numbered from 1 for the life of the stream and
+  // never reused across reconnections. 0 for the connection events.
+  uint64_t first = 0;
+  uint64_t last  = 0;
+  // the command name
+  std::string_view name{};
+  size_t bytes = 0;
+  boost::system::error_code ec{};
+  bool error_reply = false;
+  std::chrono::steady_clock::time_point time{};
+};
+
+/**
+ * Receives the events, see redis::otel_tracer for OpenTelemetry.
+ *
+ * `on_event` is called synchronously from the threads running the streams,
+ *possibly several at once, and should be quick.
+ **/
+class tracer
+{
+public:
+  virtual ~tracer() = default;
+
+  virtual void on_event(const event& e) = 0;
+};
+
+/**
+ * Sets the tracer of every stream, nullptr to stop tracing. A tracer
+ *replaced is kept alive until the program exits, as events may still be
+ *delivered to it.
+ **/
+void set_tracer(std::shared_ptr<tracer> t);
+
+tracer* get_tracer() noexcept;
+
+/**
+ * Delivers the event built by `make` to the tracer. `make` is only called
+ *when tracing is enabled and a tracer is set.
+ **/
+template<class MakeEvent>
+inline void emit(MakeEvent&& make)
+{
+  if constexpr (enabled)
+  {
+    if (auto t = get_tracer())
+    {
+      event e = make();
+      e.time  = std::chrono::steady_clock::now();
+
+      t->on_event(e);
+    }
+  }
+}
+}  // namespace redis::trace
+
+#endif
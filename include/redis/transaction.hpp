@@ -0,0 +1,145 @@
+#ifndef REDIS_TRANSACTION_H
+#define REDIS_TRANSACTION_H
+
+#include <redis/command.hpp>
+#include <redis/parser.hpp>
+
+#include <boost/variant2/variant.hpp>
+#include <string>
+
+namespace redis
+{
+/**
+ * transaction collects the commands of a MULTI/EXEC block.
+ *
+ * The commands are encoded as they are added and sent together with MULTI
+ *and EXEC in a single write by `stream::async_exec`.
+ **/
+class transaction
+{
+public:
+  transaction()
+      : size_(0)
+  {
+  }
+
+  /**
+   * Adds a command to the transaction.
+   *
+   * @param args Are the command and arguments. For example: "SET", "key",
+   *"value".
+   **/
+  template<class... Args>
+  transaction& add(const Args&... args)
+  {
+    command::encode(commands_, args...);
+    size_++;
+
+    return *this;
+  }
+
+  /**
+   * Adds a command whose arguments are only known at runtime.
+   **/
+  transaction& add(const std::vector<std::string>& args)
+  {
+    command::encode(commands_, args);
+    size_++;
+
+    return *this;
+  }
+
+  /**
+   * Returns the number of commands added.
+   **/
+  size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * Removes all the commands.
+   **/
+  void clear()
+  {
+    commands_.clear();
+    size_ = 0;
+  }
+
+  /**
+   * Returns the encoded commands, without MULTI and EXEC.
+   **/
+  const std::string& data() const
+  {
+    return commands_;
+  }
+
+private:
+  std::string commands_;
+  size_t size_;
+};
+
+/**
+ * The outcome of a transaction.
+ **/
+class transaction_result
+{
+public:
+  using any_type = redis::parser::any_type;
+
+  explicit transaction_result(any_type reply);
+
+  /**
+   * Returns whether the transaction wasn't executed because a watched key
+   *changed.
+   **/
+  bool aborted() const;
+
+  /**
+   * Returns the error that made the whole transaction fail, nullptr if it
+   *was executed. When a command couldn't be queued this is its error.
+   *
+   * Commands that fail while executing don't fail the transaction; their
+   *error is their result.
+   **/
+  const redis::types::error* error() const;
+
+  /**
+   * Returns the number of results, one per command.
+   **/
+  size_t size() const;
+
+  /**
+   * Returns the result of the command at `pos`.
+   **/
+  any_type& operator[](size_t pos);
+
+  /**
+   * Returns the result of the command at `pos` if it is a `T`, nullptr
+   *otherwise.
+   **/
+  template<class T>
+  T* get(size_t pos)
+  {
+    return boost::variant2::get_if<T>(&(*this)[pos]);
+  }
+
+  /**
+   * Returns the raw EXEC reply.
+   **/
+  any_type& reply()
+  {
+    return reply_;
+  }
+
+private:
+  any_type reply_;
+};
+}  // namespace redis
+
+#endif
@@ -30,6 +30,8 @@ public:
 
   void serialize(std::ostream& os) const;
 
+  void serialize(std::string& out) const;
+
   size_t expected_length() const;
 
   size_t processed() const;
@@ -40,6 +42,11 @@ public:
 
   operator bool() const;
 
+  // whether parse read a whole array, null and empty arrays included
+  bool complete() const;
+
+  bool is_null() const;
+
   template<class T>
   inline void push_back(const T& v)
   {
@@ -57,6 +64,7 @@ public:
 private:
   container vs_;
   bool is_null_;
+  bool has_header_;
   // for partial reads
   size_t expected_length_;
   size_t processed_;
@@ -13,6 +13,7 @@ class error
   std::string e_;
   // for partial reads
   size_t expected_length_;
+  bool complete_ = false;
 
 public:
   error() = default;
@@ -20,8 +21,12 @@ public:
 
   void serialize(std::ostream& os) const;
 
+  void serialize(std::string& out) const;
+
   operator bool() const;
 
+  bool complete() const;
+
   const std::string& operator*() const;
 
   error& operator=(const std::string& e);
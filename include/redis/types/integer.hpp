@@ -23,11 +23,15 @@ public:
 
   void serialize(std::ostream& os) const;
 
-  inline int64_t operator*() const;
+  void serialize(std::string& out) const;
+
+  int64_t operator*() const;
 
   operator bool() const;
 
-  inline integer& operator=(int64_t n);
+  bool complete() const;
+
+  integer& operator=(int64_t n);
 };
 
 }  // namespace redis::types
@@ -1,6 +1,7 @@
 #ifndef REDIS_TYPES_STRING_H
 #define REDIS_TYPES_STRING_H
 
+#include <optional>
 #include <string>
 #include <ostream>
 
@@ -15,10 +16,12 @@ class string
   // for partial reads
   size_t expected_length_;
   bool is_null_;
+  bool complete_;
 
 public:
   string();
 
+  // shortest text that parses back to d
   string(double d);
 
   string(const std::string& s);
@@ -27,23 +30,35 @@ public:
 
   size_t parse(const char* s, size_t n);
 
+  // values with CR or LF are always serialized as bulk strings, a simple
+  // string can't hold them
   void serialize(std::ostream& os, bool is_bulk = true) const;
 
+  void serialize(std::string& out, bool is_bulk = true) const;
+
   operator bool() const;
 
+  // whether parse read a whole value, null and empty strings included
+  bool complete() const;
+
   const std::string& operator*() const;
 
   std::string& operator*();
 
   bool is_null() const;
 
-  inline string& operator=(const std::string& s);
+  string& operator=(const std::string& s);
 
   size_t size() const;
 
+  // the value as a number, e.g. a score; nullopt if it isn't one
+  std::optional<double> to_double() const;
+
   std::string::value_type operator[](size_t pos);
 
 private:
+  bool is_binary() const;
+
   size_t parse_simple(const char* s, size_t n);
 
   void serialize_simple(std::ostream& os) const;
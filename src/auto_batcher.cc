@@ -0,0 +1,134 @@
+#include <redis/auto_batcher.hpp>
+
+#include <limits>
+
+namespace redis
+{
+static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+auto_batcher::auto_batcher(redis::stream& s, duration window,
+                           size_t max_batch)
+    : stream_(s)
+    , window_(window)
+    , max_batch_(max_batch > 0 ? max_batch : 1)
+    , get_(npos)
+    , set_(npos)
+    , last_read_(npos)
+    , last_write_(npos)
+    , timer_(s.get_executor())
+    , is_armed_(false)
+{
+}
+
+auto_batcher::~auto_batcher()
+{
+  flush();
+}
+
+auto auto_batcher::open(kind type, const std::string& key) -> batch&
+{
+  // a read can join the batch of its kind unless writes were issued since
+  // it was opened, and a write unless reads were
+  size_t* index = type == get ? &get_ : type == set ? &set_ : &hgets_[key];
+  size_t barrier = type == set ? last_read_ : last_write_;
+
+  if (*index != npos && (barrier == npos || *index > barrier))
+    return batches_[*index];
+
+  *index = batches_.size();
+  (type == set ? last_write_ : last_read_) = *index;
+
+  auto& b = batches_.emplace_back();
+  b.type  = type;
+
+  switch (type)
+  {
+    case get:
+      b.args.push_back("MGET");
+      break;
+    case set:
+      b.args.push_back("MSET");
+      break;
+    case hget:
+      b.args.push_back("HMGET");
+      b.args.push_back(key);
+      break;
+  }
+
+  return b;
+}
+
+void auto_batcher::added(batch& b)
+{
+  if (b.readers.size() + b.writers.size() >= max_batch_)
+    return flush();
+
+  if (is_armed_)
+    return;
+  is_armed_ = true;
+
+  // a timer expiring straight away fires once the handlers ready have run
+  timer_.expires_after(window_);
+  timer_.async_wait(
+      [this](auto&& ec)
+      {
+        if (!ec)
+          flush();
+      });
+}
+
+void auto_batcher::flush()
+{
+  if (is_armed_)
+  {
+    is_armed_ = false;
+    timer_.cancel();
+  }
+
+  // the stream writes them in this order
+  auto batches = std::move(batches_);
+  batches_.clear();
+  get_        = npos;
+  set_        = npos;
+  last_read_  = npos;
+  last_write_ = npos;
+  hgets_.clear();
+
+  for (auto&& b : batches)
+    send(b);
+}
+
+void auto_batcher::send(batch& b)
+{
+  if (b.type == set)
+  {
+    stream_.async_write(
+        [writers = std::move(b.writers)](boost::system::error_code ec,
+                                         ignore_t)
+        {
+          for (auto&& w : writers)
+            w->complete(ec);
+        },
+        typed_command<ignore_t>(b.args));
+    return;
+  }
+
+  stream_.async_write(
+      [readers = std::move(b.readers)](
+          boost::system::error_code ec,
+          std::vector<std::optional<std::string>> values)
+      {
+        if (!ec && values.size() != readers.size())
+          ec = errc::unexpected_reply;
+
+        for (size_t i = 0; i < readers.size(); i++)
+        {
+          if (ec)
+            readers[i]->complete(ec, std::nullopt);
+          else
+            readers[i]->complete(ec, std::move(values[i]));
+        }
+      },
+      typed_command<std::vector<std::optional<std::string>>>(b.args));
+}
+}  // namespace redis
@@ -1,11 +1,32 @@
 #include <redis/basic_stream.hpp>
+#include <redis/command.hpp>
+#include <redis/resp_reader.hpp>
+
+#include <algorithm>
 
 namespace redis
 {
+static const std::string unix_scheme = "unix://";
+
 basic_stream::basic_stream(boost::asio::io_context& ioc)
     : stream_(ioc)
+    , tls_context_(nullptr)
+    , session_(nullptr, SSL_SESSION_free)
+    , handshake_count_(0)
+    , resolve_ttl_(std::chrono::seconds(DEFAULT_RESOLVE_TTL))
+    , standby_count_(0)
+    , standby_timer_(ioc)
     , is_closed_(false)
+    , is_reconnecting_(false)
+    , lifetime_(std::make_shared<char>())
+{
+}
+
+basic_stream::~basic_stream()
 {
+  // the spare connections in progress complete as cancelled, without
+  // touching the stream
+  close_standby();
 }
 
 auto basic_stream::get_executor() -> asio_stream::executor_type
@@ -25,6 +46,9 @@ void basic_stream::connect(const std::string& hostport)
 void basic_stream::connect(const std::string& hostport,
                            boost::system::error_code& ec)
 {
+  if (is_local(hostport))
+    return connect(hostport, "", ec);
+
   std::vector<std::string> v{2};
   boost::split(v, hostport, boost::is_any_of(":"));
   connect(v[0], v[1], ec);
@@ -42,67 +66,520 @@ void basic_stream::connect(const std::string& host, const std::string& port)
 void basic_stream::connect(const std::string& host, const std::string& port,
                            boost::system::error_code& ec)
 {
-  boost::asio::ip::tcp::resolver resolver(stream_.get_executor());
-  auto const results = resolver.resolve(host, port, ec);
-  if (ec)
-    return;
+  if (is_local(host))
+  {
+    auto endpoint = local_endpoint(host, ec);
+    if (ec)
+      return;
+
+    if (stream_.is_open())
+      close();
 
-  if (stream_.is_open())
-    close();
+    stream_.connect(endpoint, ec);
+  }
+  else
+  {
+    if (stream_.is_open())
+      close();
+
+    bool cached = is_resolved(host, port);
+    if (cached)
+      boost::asio::connect(stream_, endpoints_, ec);
+
+    // the host may have moved
+    if (!cached || ec)
+    {
+      boost::asio::ip::tcp::resolver resolver(stream_.get_executor());
+      auto const results = resolver.resolve(host, port, ec);
+      if (ec)
+        return;
+
+      resolved(host, port, results);
+      boost::asio::connect(stream_, endpoints_, ec);
+    }
+  }
 
   original_host_ = host;
   original_port_ = port;
 
-  boost::asio::connect(stream_, results.begin(), results.end(), ec);
   if (ec)
     return;
 
+  if (tls_context_)
+  {
+    start_tls();
+
+    ssl_->handshake(boost::asio::ssl::stream_base::client, ec);
+    if (ec)
+      return;
+  }
+
+  if (!handshake_.empty())
+  {
+    send_handshake(ec);
+    if (ec)
+    {
+      boost::system::error_code ignored;
+      stream_.close(ignored);
+      return;
+    }
+  }
+
   is_closed_ = false;
   stream_.non_blocking(true);
+
+  trace::emit([this]
+              { return trace::event{trace::event_type::connected, this}; });
+
+  fill_standby();
 }
 
-void basic_stream::async_connect(const std::string& hostport, on_connect_cb cb)
+void basic_stream::set_tls(boost::asio::ssl::context& ctx,
+                           tls_options options)
 {
-  std::vector<std::string> v{2};
-  boost::split(v, hostport, boost::is_any_of(":"));
-  async_connect(v[0], v[1], cb);
+  boost::system::error_code ec;
+
+  set_tls(ctx, std::move(options), ec);
+  if (ec)
+    throw ec;
 }
 
-void basic_stream::async_connect(const std::string& host,
-                                 const std::string& port, on_connect_cb cb)
+void basic_stream::set_tls(boost::asio::ssl::context& ctx,
+                           tls_options options, boost::system::error_code& ec)
 {
-  if (stream_.is_open())
-    close();
+  auto native = ctx.native_handle();
 
-  auto resolver =
-      std::make_shared<boost::asio::ip::tcp::resolver>(stream_.get_executor());
+  if ((!options.ciphers.empty() &&
+       SSL_CTX_set_cipher_list(native, options.ciphers.c_str()) != 1) ||
+      (!options.ciphersuites.empty() &&
+       SSL_CTX_set_ciphersuites(native, options.ciphersuites.c_str()) != 1))
+  {
+    ec = boost::system::error_code(static_cast<int>(ERR_get_error()),
+                                   boost::asio::error::get_ssl_category());
+    return;
+  }
 
-  original_host_ = host;
-  original_port_ = port;
+  // sessions are kept by each stream for its own reconnections, not by the
+  // context
+  SSL_CTX_set_session_cache_mode(
+      native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(native, &basic_stream::on_new_session);
+
+  alpn_.clear();
+  for (auto&& protocol : options.alpn)
+  {
+    alpn_ += static_cast<char>(protocol.size());
+    alpn_ += protocol;
+  }
+
+  tls_context_ = &ctx;
+  tls_options_ = std::move(options);
+  session_.reset();
+  ec = {};
+}
+
+bool basic_stream::session_reused()
+{
+  return ssl_ && SSL_session_reused(ssl_->native_handle()) == 1;
+}
+
+void basic_stream::set_handshake(handshake_options options)
+{
+  std::vector<std::vector<std::string>> commands;
+
+  bool auth = !options.user.empty() || !options.password.empty();
+  auto user = options.user.empty() ? std::string("default") : options.user;
+
+  if (options.hello)
+  {
+    std::vector<std::string> hello{"HELLO", "2"};
+    if (auth)
+      hello.insert(hello.end(), {"AUTH", user, options.password});
+    if (!options.client_name.empty())
+      hello.insert(hello.end(), {"SETNAME", options.client_name});
 
-  resolver->async_resolve(original_host_, original_port_,
-                          [this, resolver, cb](auto&& ec, auto&& results)
-                          {
-                            if (ec)
-                            {
-                              return cb(ec);
-                            }
+    commands.push_back(std::move(hello));
+  }
+  else
+  {
+    if (auth && options.user.empty())
+      commands.push_back({"AUTH", options.password});
+    else if (auth)
+      commands.push_back({"AUTH", options.user, options.password});
 
-                            boost::asio::async_connect(
-                                stream_, results,
-                                [this, cb](auto&& ec, auto&& _)
-                                {
-                                  is_closed_ = false;
+    if (!options.client_name.empty())
+      commands.push_back({"CLIENT", "SETNAME", options.client_name});
+  }
 
-                                  stream_.non_blocking(true);
+  if (options.database != 0)
+    commands.push_back({"SELECT", std::to_string(options.database)});
 
-                                  cb(ec);
-                                });
-                          });
+  for (auto&& args : options.commands)
+    commands.push_back(std::move(args));
+
+  handshake_.clear();
+  for (auto&& args : commands)
+    command::encode(handshake_, args);
+
+  handshake_count_ = commands.size();
+}
+
+void basic_stream::send_handshake(boost::system::error_code& ec)
+{
+  handshake_replies_.clear();
+
+  if (ssl_)
+    boost::asio::write(*ssl_, boost::asio::buffer(handshake_), ec);
+  else
+    boost::asio::write(stream_, boost::asio::buffer(handshake_), ec);
+
+  while (!ec && !handshake_replied(ec))
+  {
+    size_t filled = handshake_replies_.size();
+    handshake_replies_.resize(filled + handshake_read_size);
+
+    auto buffer =
+        boost::asio::buffer(&handshake_replies_[filled], handshake_read_size);
+    size_t bytes =
+        ssl_ ? ssl_->read_some(buffer, ec) : stream_.read_some(buffer, ec);
+    handshake_replies_.resize(filled + bytes);
+  }
+}
+
+bool basic_stream::handshake_replied(boost::system::error_code& ec)
+{
+  resp_reader reader(handshake_replies_.data(), handshake_replies_.size());
+  resp_reader::value v;
+  std::string error;
+
+  for (size_t i = 0; i < handshake_count_; i++)
+  {
+    if (!reader.skip(v))
+      return false;
+
+    if (v.type == '-' && error.empty())
+      error = v.data;
+  }
+
+  handshake_error_ = std::move(error);
+  if (!handshake_error_.empty())
+    ec = errc::handshake_failed;
+
+  return true;
+}
+
+void basic_stream::set_standby(size_t count)
+{
+  standby_count_ = count;
+
+  while (standby_.size() > standby_count_)
+  {
+    boost::system::error_code ignored;
+    standby_.back()->socket.close(ignored);
+    standby_.pop_back();
+  }
+
+  if (!is_closed_ && stream_.is_open())
+    fill_standby();
+}
+
+bool basic_stream::is_resolved(const std::string& host,
+                               const std::string& port) const
+{
+  return !endpoints_.empty() && host == resolved_host_ &&
+         port == resolved_port_ &&
+         std::chrono::steady_clock::now() - resolved_at_ < resolve_ttl_;
+}
+
+void basic_stream::resolved(
+    const std::string& host, const std::string& port,
+    const boost::asio::ip::tcp::resolver::results_type& results)
+{
+  endpoints_     = endpoints(results);
+  resolved_host_ = host;
+  resolved_port_ = port;
+  resolved_at_   = std::chrono::steady_clock::now();
+}
+
+void basic_stream::fill_standby()
+{
+  std::vector<asio_stream::endpoint_type> to;
+  if (is_local(original_host_))
+  {
+    boost::system::error_code ec;
+    to.push_back(local_endpoint(original_host_, ec));
+    if (ec)
+      return;
+  }
+  else
+  {
+    // a stale address only costs a spare connection failing, the next
+    // connection resolves again
+    to = endpoints_;
+  }
+
+  while (standby_.size() < standby_count_ && !to.empty())
+  {
+    auto s = std::make_shared<standby>(stream_.get_executor());
+    standby_.push_back(s);
+
+    boost::asio::async_connect(
+        s->socket, to,
+        [this, s](boost::system::error_code ec, auto&&)
+        {
+          // closed along with the stream, which may be gone
+          if (ec == boost::asio::error::operation_aborted)
+            return;
+
+          if (!ec)
+          {
+            s->ready = true;
+            return watch(s);
+          }
+
+          drop(s);
+
+          // ... retry
+          standby_timer_.expires_after(std::chrono::seconds(1));
+          standby_timer_.async_wait(
+              [this](auto&& ec)
+              {
+                if (!ec)
+                  fill_standby();
+              });
+        });
+  }
+}
+
+void basic_stream::close_standby()
+{
+  standby_timer_.cancel();
+
+  for (auto&& s : standby_)
+  {
+    boost::system::error_code ignored;
+    s->socket.close(ignored);
+  }
+
+  standby_.clear();
+}
+
+void basic_stream::watch(std::shared_ptr<standby> s)
+{
+  auto& socket = s->socket;
+  socket.async_read_some(boost::asio::buffer(&s->probe, 1),
+                         [this, s](boost::system::error_code ec, size_t)
+                         {
+                           // swapped in or closed along with the stream
+                           if (ec == boost::asio::error::operation_aborted)
+                             return;
+
+                           // closed by the server, or unexpected data
+                           drop(s);
+                           fill_standby();
+                         });
+}
+
+void basic_stream::drop(const std::shared_ptr<standby>& s)
+{
+  boost::system::error_code ignored;
+  s->socket.close(ignored);
+
+  auto it = std::find(standby_.begin(), standby_.end(), s);
+  if (it != standby_.end())
+    standby_.erase(it);
+}
+
+bool basic_stream::swap_standby()
+{
+  std::shared_ptr<standby> s;
+  while (!s)
+  {
+    auto it = std::find_if(standby_.begin(), standby_.end(),
+                           [](auto&& s) { return s->ready; });
+    if (it == standby_.end())
+      return false;
+
+    s = *it;
+    standby_.erase(it);
+
+    // a server restarting closes the spare connections too, maybe before
+    // their watch completes
+    boost::system::error_code ec;
+    s->socket.non_blocking(true, ec);
+    if (!ec)
+      s->socket.receive(boost::asio::buffer(&s->probe, 1),
+                        asio_stream::message_peek, ec);
+
+    if (ec != boost::asio::error::would_block)
+    {
+      s->socket.close(ec);
+      s.reset();
+    }
+  }
+
+  boost::system::error_code ignored;
+  s->socket.cancel(ignored);
+
+  // the operations of the lost connection complete first, seeing the stream
+  // still reconnecting
+  boost::asio::post(stream_.get_executor(),
+                    [this, s]
+                    {
+                      if (is_closed_)
+                      {
+                        is_reconnecting_ = false;
+                        return;
+                      }
+
+                      stream_ = std::move(s->socket);
+
+                      if (!tls_context_)
+                        return on_swapped_tls({});
+
+                      start_tls();
+                      ssl_->async_handshake(
+                          boost::asio::ssl::stream_base::client,
+                          [this](auto&& ec) { on_swapped_tls(ec); });
+                    });
+
+  return true;
+}
+
+void basic_stream::on_swapped_tls(boost::system::error_code ec)
+{
+  if (ec || handshake_.empty())
+    return on_swapped(ec);
+
+  async_send_handshake([this](auto&& ec) { on_swapped(ec); });
+}
+
+void basic_stream::on_swapped(boost::system::error_code ec)
+{
+  if (ec)
+  {
+    stream_.close();
+    return reconnect();
+  }
+
+  stream_.non_blocking(true);
+
+  trace::emit([this]
+              { return trace::event{trace::event_type::connected, this}; });
+
+  is_reconnecting_ = false;
+  fill_standby();
+
+  if (on_reconnect_cb_)
+    on_reconnect_cb_();
+}
+
+// index of the basic_stream in the ex data of its SSL objects
+static int stream_index()
+{
+  static const int index =
+      SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+void basic_stream::start_tls()
+{
+  namespace ssl = boost::asio::ssl;
+
+  ssl_.emplace(stream_, *tls_context_);
+
+  auto native = ssl_->native_handle();
+  SSL_set_ex_data(native, stream_index(), this);
+
+  auto& name = tls_options_.server_name;
+  if (!name.empty())
+    SSL_set_tlsext_host_name(native, name.c_str());
+
+  if (tls_options_.verify_peer)
+  {
+    ssl_->set_verify_mode(ssl::verify_peer);
+    if (!name.empty())
+      ssl_->set_verify_callback(ssl::host_name_verification(name));
+  }
+  else
+  {
+    ssl_->set_verify_mode(ssl::verify_none);
+  }
+
+  if (!alpn_.empty())
+    SSL_set_alpn_protos(native,
+                        reinterpret_cast<const unsigned char*>(alpn_.data()),
+                        static_cast<unsigned>(alpn_.size()));
+
+  if (session_)
+    SSL_set_session(native, session_.get());
+}
+
+int basic_stream::on_new_session(SSL* ssl, SSL_SESSION* session)
+{
+  auto self = static_cast<basic_stream*>(SSL_get_ex_data(ssl, stream_index()));
+  if (self == nullptr)
+    return 0;
+
+  // the session is still the one of the connection, which OpenSSL marks as
+  // not resumable if the connection ends without a TLS shutdown, as lost
+  // connections do. A copy stays resumable.
+  self->session_.reset(SSL_SESSION_dup(session));
+  return 0;
+}
+
+auto basic_stream::endpoints(
+    const boost::asio::ip::tcp::resolver::results_type& results)
+    -> std::vector<asio_stream::endpoint_type>
+{
+  std::vector<asio_stream::endpoint_type> v;
+  for (auto&& entry : results)
+    v.emplace_back(entry.endpoint());
+
+  return v;
+}
+
+bool basic_stream::is_local(const std::string& host)
+{
+  return host.rfind(unix_scheme, 0) == 0;
+}
+
+auto basic_stream::local_endpoint(const std::string& host,
+                                  boost::system::error_code& ec)
+    -> asio_stream::endpoint_type
+{
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+  // the endpoint throws name_too_long for a path longer than sun_path
+  auto path = host.substr(unix_scheme.size());
+  if (path.size() >= sizeof(sockaddr_un::sun_path))
+  {
+    ec = boost::asio::error::name_too_long;
+    return {};
+  }
+
+  ec = {};
+  return boost::asio::local::stream_protocol::endpoint(path);
+#else
+  ec = boost::asio::error::operation_not_supported;
+  return {};
+#endif
 }
 
 void basic_stream::reconnect_report(boost::system::error_code ec)
 {
+  // reads and writes in flight all fail, only the first one reconnects
+  if (is_reconnecting_)
+    return;
+  is_reconnecting_ = true;
+
+  trace::emit(
+      [&]
+      {
+        trace::event e{trace::event_type::disconnected, this};
+        e.ec = ec;
+        return e;
+      });
+
   stream_.close();
 
   if (on_stream_closed_cb_)
@@ -114,6 +591,12 @@ void basic_stream::reconnect_report(boost::system::error_code ec)
 void basic_stream::reconnect()
 {
   if (is_closed_)
+  {
+    is_reconnecting_ = false;
+    return;
+  }
+
+  if (swap_standby())
     return;
 
   async_connect(original_host_, original_port_,
@@ -125,10 +608,18 @@ void basic_stream::reconnect()
                     auto timer = std::make_shared<boost::asio::deadline_timer>(
                         stream_.get_executor());
                     timer->expires_from_now(boost::posix_time::seconds(1));
-                    timer->async_wait([this, timer](auto&& _) { reconnect(); });
+                    timer->async_wait(
+                        [this, timer,
+                         lifetime = std::weak_ptr<void>(lifetime_)](auto&&)
+                        {
+                          if (!lifetime.expired())
+                            reconnect();
+                        });
                   }
                   else
                   {
+                    is_reconnecting_ = false;
+
                     if (on_reconnect_cb_)
                       on_reconnect_cb_();
                   }
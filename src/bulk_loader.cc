@@ -0,0 +1,309 @@
+#include <redis/bulk_loader.hpp>
+#include <redis/error.hpp>
+#include <redis/resp_reader.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace redis
+{
+static const std::string_view client_reply_off =
+    "*3\r\n$6\r\nCLIENT\r\n$5\r\nREPLY\r\n$3\r\nOFF\r\n";
+static const std::string_view client_reply_on =
+    "*3\r\n$6\r\nCLIENT\r\n$5\r\nREPLY\r\n$2\r\nON\r\n";
+
+// reads a RESP file handing out whole commands only
+struct file_source
+{
+  std::ifstream file;
+  // bytes read after the last whole command
+  std::string carry;
+  // set when the file stops before its end or isn't made of commands
+  boost::system::error_code ec;
+
+  size_t operator()(std::string& out, size_t max_bytes)
+  {
+    size_t commands = 0;
+
+    while (commands == 0 && file)
+    {
+      // up to max_bytes in out, more while a large command is incomplete so
+      // it isn't parsed again for every few bytes
+      size_t size = max_bytes > out.size() ? max_bytes - out.size() : 1;
+      size        = std::max(size, carry.size());
+
+      size_t old_size = carry.size();
+      carry.resize(old_size + size);
+      file.read(&carry[old_size], size);
+      carry.resize(old_size + file.gcount());
+
+      resp_reader r(carry.data(), carry.size());
+      size_t whole = 0;
+      while (r.skip())
+      {
+        whole = r.position();
+        commands++;
+      }
+
+      out.append(carry, 0, whole);
+      carry.erase(0, whole);
+
+      // every command is an array, anything else isn't RESP
+      if (commands == 0 && !carry.empty() &&
+          (carry[0] != '*' || carry.size() > DEFAULT_BULK_MAX_COMMAND_SIZE))
+      {
+        ec = errc::malformed_command;
+        return 0;
+      }
+    }
+
+    if (file.bad())
+      ec = boost::system::errc::make_error_code(boost::system::errc::io_error);
+    else if (commands == 0 && !carry.empty())
+      ec = errc::malformed_command;
+
+    return commands;
+  }
+};
+
+bulk_loader::bulk_loader(boost::asio::io_context& ioc)
+    : stream_(ioc)
+    , chunk_size_(DEFAULT_BULK_CHUNK_SIZE)
+    , reply_mode_(reply_mode::count)
+    , is_exhausted_(true)
+    , result_{0, 0}
+    , expected_(0)
+    , received_(0)
+    , is_running_(false)
+    , is_reading_(false)
+    , is_writing_(false)
+{
+}
+
+auto bulk_loader::get_executor() -> basic_stream::asio_stream::executor_type
+{
+  return stream_.get_executor();
+}
+
+void bulk_loader::connect(const std::string& hostport)
+{
+  stream_.connect(hostport);
+}
+
+void bulk_loader::connect(const std::string& hostport,
+                          boost::system::error_code& ec) noexcept
+{
+  stream_.connect(hostport, ec);
+}
+
+void bulk_loader::connect(const std::string& host, const std::string& port)
+{
+  stream_.connect(host, port);
+}
+
+void bulk_loader::connect(const std::string& host, const std::string& port,
+                          boost::system::error_code& ec) noexcept
+{
+  stream_.connect(host, port, ec);
+}
+
+void bulk_loader::async_connect(const std::string& hostport,
+                                basic_stream::on_connect_cb cb) noexcept
+{
+  stream_.async_connect(hostport, cb);
+}
+
+void bulk_loader::async_connect(const std::string& host,
+                                const std::string& port,
+                                basic_stream::on_connect_cb cb) noexcept
+{
+  stream_.async_connect(host, port, cb);
+}
+
+void bulk_loader::async_load(source src, done_cb cb)
+{
+  source_       = src;
+  on_done_cb_   = cb;
+  is_exhausted_ = false;
+  is_running_   = true;
+
+  source_error_ = {};
+
+  result_   = {0, 0};
+  expected_ = 0;
+  received_ = 0;
+
+  write_buffer_.clear();
+  read_buffer_.consume(read_buffer_.size());
+
+  if (reply_mode_ == reply_mode::off)
+    write_buffer_.append(client_reply_off);
+
+  fill();
+  write();
+}
+
+void bulk_loader::async_load_file(const std::string& path, done_cb cb)
+{
+  auto src = std::make_shared<file_source>();
+  src->file.open(path, std::ios::binary);
+
+  if (!src->file)
+  {
+    boost::asio::post(stream_.get_executor(),
+                      [cb]()
+                      {
+                        cb(boost::system::errc::make_error_code(
+                               boost::system::errc::no_such_file_or_directory),
+                           {0, 0});
+                      });
+    return;
+  }
+
+  async_load(
+      [this, src](std::string& out, size_t max_bytes)
+      {
+        size_t commands = (*src)(out, max_bytes);
+        if (src->ec)
+          source_error_ = src->ec;
+
+        return commands;
+      },
+      cb);
+}
+
+void bulk_loader::fill()
+{
+  if (is_exhausted_ || write_buffer_.size() >= chunk_size_)
+    return;
+
+  size_t commands = source_(write_buffer_, chunk_size_);
+
+  result_.commands += commands;
+  if (reply_mode_ == reply_mode::count)
+    expected_ += commands;
+
+  if (commands == 0)
+  {
+    is_exhausted_ = true;
+    source_       = nullptr;
+
+    // turning replies back on is acknowledged once everything before it has
+    // been processed
+    if (reply_mode_ == reply_mode::off)
+    {
+      write_buffer_.append(client_reply_on);
+      expected_++;
+    }
+  }
+}
+
+void bulk_loader::write()
+{
+  if (is_writing_ || !is_running_)
+    return;
+
+  if (write_buffer_.empty())
+  {
+    if (is_exhausted_ && received_ == expected_)
+      finish(source_error_);
+    return;
+  }
+  is_writing_ = true;
+
+  std::swap(write_buffer_, sending_buffer_);
+
+  stream_.async_write(boost::asio::buffer(sending_buffer_),
+                      [this](auto&& ec, size_t)
+                      {
+                        is_writing_ = false;
+                        sending_buffer_.clear();
+
+                        if (ec)
+                          return finish(ec);
+
+                        fill();
+                        write();
+                      });
+
+  // get the next chunk ready while this one is written
+  fill();
+  read();
+}
+
+void bulk_loader::read()
+{
+  if (is_reading_ || !is_running_ || received_ == expected_)
+    return;
+  is_reading_ = true;
+
+  stream_.async_read_some(read_buffer_.prepare(DEFAULT_BULK_READ_SIZE),
+                          [this](auto&& ec, size_t read_bytes)
+                          { on_read(ec, read_bytes); });
+}
+
+void bulk_loader::on_read(boost::system::error_code const& ec,
+                          size_t read_bytes)
+{
+  is_reading_ = false;
+
+  if (ec)
+    return finish(ec);
+
+  read_buffer_.commit(read_bytes);
+
+  resp_reader r((const char*) read_buffer_.data().data(),
+                read_buffer_.size());
+
+  // bytes of the replies read entirely
+  size_t consumed = 0;
+
+  while (received_ < expected_)
+  {
+    resp_reader::value v;
+    if (!r.skip(v))
+      break;
+
+    if (v.type == '-')
+    {
+      result_.errors++;
+
+      if (on_error_cb_)
+      {
+        redis::types::error e;
+        e = std::string(v.data);
+
+        on_error_cb_(received_, e);
+      }
+    }
+
+    consumed = r.position();
+    received_++;
+  }
+
+  read_buffer_.consume(consumed);
+
+  if (is_exhausted_ && received_ == expected_ && !is_writing_ &&
+      write_buffer_.empty())
+  {
+    return finish(source_error_);
+  }
+
+  read();
+}
+
+void bulk_loader::finish(boost::system::error_code ec)
+{
+  if (!is_running_)
+    return;
+  is_running_ = false;
+
+  source_ = nullptr;
+
+  auto cb = std::move(on_done_cb_);
+  on_done_cb_ = nullptr;
+
+  if (cb)
+    cb(ec, result_);
+}
+}  // namespace redis
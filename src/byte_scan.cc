@@ -0,0 +1,173 @@
+#include <redis/byte_scan.hpp>
+
+#include <cstring>
+
+#ifdef REDIS_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace redis
+{
+static bool is_prefix(char c)
+{
+  return c == '+' || c == '-' || c == ':' || c == '$' || c == '*';
+}
+
+static size_t find_prefix_scalar(const char* s, size_t n)
+{
+  size_t i = 0;
+  while (i < n && !is_prefix(s[i]))
+    i++;
+
+  return i;
+}
+
+#ifdef REDIS_SCAN_X86
+// bit i of the mask is set if s[i] is a prefix
+static int prefix_mask_sse2(__m128i v)
+{
+  __m128i m = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('-'))),
+      _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('$'))),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('*'))));
+
+  return _mm_movemask_epi8(m);
+}
+
+namespace detail
+{
+size_t find_prefix_sse2(const char* s, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    if (int mask = prefix_mask_sse2(v))
+      return i + __builtin_ctz(mask);
+  }
+
+  return i + find_prefix_scalar(s + i, n - i);
+}
+
+__attribute__((target("avx2"))) size_t find_prefix_avx2(const char* s,
+                                                        size_t n)
+{
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('+')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'))),
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$'))),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*'))));
+
+    if (unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m)))
+      return i + __builtin_ctz(mask);
+  }
+
+  return i + find_prefix_sse2(s + i, n - i);
+}
+
+// position of the first \r followed by \n, looking at 16 bytes at a time
+size_t find_crlf_sse2(const char* s, size_t n)
+{
+  size_t i = 0;
+  for (; i + 17 <= n; i += 16)
+  {
+    __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    __m128i nx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 1));
+    int mask   = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+        _mm_cmpeq_epi8(nx, _mm_set1_epi8('\n'))));
+
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+
+  for (; i + 1 < n; i++)
+  {
+    if (s[i] == '\r' && s[i + 1] == '\n')
+      return i;
+  }
+
+  return n;
+}
+
+__attribute__((target("avx2"))) size_t find_crlf_avx2(const char* s,
+                                                      size_t n)
+{
+  size_t i = 0;
+  for (; i + 33 <= n; i += 32)
+  {
+    __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+    __m256i nx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 1));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                         _mm256_cmpeq_epi8(nx, _mm256_set1_epi8('\n')))));
+
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+
+  size_t p = find_crlf_sse2(s + i, n - i);
+  return p == n - i ? n : i + p;
+}
+
+bool has_avx2()
+{
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+}
+}  // namespace detail
+
+using scan_fn = size_t (*)(const char*, size_t);
+
+size_t find_crlf(const char* s, size_t n)
+{
+  static const scan_fn fn =
+      detail::has_avx2() ? detail::find_crlf_avx2 : detail::find_crlf_sse2;
+  return fn(s, n);
+}
+
+size_t find_prefix(const char* s, size_t n)
+{
+  // replies almost always start right at the prefix
+  if (n > 0 && is_prefix(s[0]))
+    return 0;
+
+  static const scan_fn fn = detail::has_avx2() ? detail::find_prefix_avx2
+                                               : detail::find_prefix_sse2;
+  return fn(s, n);
+}
+#else
+size_t find_crlf(const char* s, size_t n)
+{
+  size_t i = 0;
+  while (i < n)
+  {
+    auto cr = static_cast<const char*>(std::memchr(s + i, '\r', n - i));
+    if (cr == nullptr || cr + 1 >= s + n)
+      return n;
+
+    i = cr - s;
+    if (s[i + 1] == '\n')
+      return i;
+
+    i++;
+  }
+
+  return n;
+}
+
+size_t find_prefix(const char* s, size_t n)
+{
+  return find_prefix_scalar(s, n);
+}
+#endif
+}  // namespace redis
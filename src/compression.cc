@@ -0,0 +1,118 @@
+#include <redis/compression.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace redis
+{
+static const std::string_view magic("\0RZ", 3);
+
+static void write_header(std::string& out, uint8_t id, uint32_t size)
+{
+  out += magic;
+  out += static_cast<char>(id);
+
+  // little endian
+  for (int i = 0; i < 4; i++)
+    out += static_cast<char>((size >> (8 * i)) & 0xff);
+}
+
+compression::compression(std::shared_ptr<const codec> c, size_t threshold,
+                         size_t threads)
+    : codec_(std::move(c))
+    , codecs_{codec_}
+    , threshold_(std::max<size_t>(threshold, header_size))
+    , pool_(threads)
+{
+}
+
+compression::~compression()
+{
+  pool_.join();
+}
+
+void compression::add(std::shared_ptr<const codec> c)
+{
+  codecs_.push_back(std::move(c));
+}
+
+void compression::compress(std::string_view value, std::string& out) const
+{
+  // a plain value starting like a compressed one gets a header anyway, or
+  // it would be taken for one when read back
+  bool ambiguous = is_compressed(value);
+
+  if (value.size() > max_size)
+    throw std::length_error("value too long to compress");
+
+  if (value.size() >= threshold_)
+  {
+    size_t start = out.size();
+    write_header(out, codec_->id(), static_cast<uint32_t>(value.size()));
+
+    if (codec_->compress(value, out) && out.size() - start < value.size())
+      return;
+
+    out.resize(start);
+  }
+
+  if (ambiguous)
+    write_header(out, 0, static_cast<uint32_t>(value.size()));
+
+  out += value;
+}
+
+bool compression::decompress(std::string_view stored, std::string& out) const
+{
+  if (!is_compressed(stored))
+  {
+    out += stored;
+    return true;
+  }
+
+  auto id       = static_cast<uint8_t>(stored[3]);
+  uint32_t size = 0;
+  for (int i = 0; i < 4; i++)
+    size |= static_cast<uint32_t>(static_cast<uint8_t>(stored[4 + i]))
+            << (8 * i);
+
+  auto payload = stored.substr(header_size);
+  if (id == 0)
+  {
+    if (payload.size() != size)
+      return false;
+
+    out += payload;
+    return true;
+  }
+
+  auto c = find(id);
+  if (c == nullptr)
+    return false;
+
+  size_t start = out.size();
+  if (!c->decompress(payload, size, out) || out.size() - start != size)
+  {
+    out.resize(start);
+    return false;
+  }
+
+  return true;
+}
+
+bool compression::is_compressed(std::string_view stored)
+{
+  return stored.size() >= header_size && stored.substr(0, 3) == magic;
+}
+
+const codec* compression::find(uint8_t id) const
+{
+  for (auto&& c : codecs_)
+  {
+    if (c->id() == id)
+      return c.get();
+  }
+
+  return nullptr;
+}
+}  // namespace redis
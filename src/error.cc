@@ -0,0 +1,48 @@
+#include <redis/error.hpp>
+
+#include <string>
+
+namespace redis
+{
+class error_category_impl : public boost::system::error_category
+{
+public:
+  const char* name() const noexcept override
+  {
+    return "redis";
+  }
+
+  std::string message(int ev) const override
+  {
+    switch (static_cast<errc>(ev))
+    {
+      case errc::connection_lost:
+        return "connection lost";
+      case errc::server_error:
+        return "server error";
+      case errc::wrong_type:
+        return "operation against a key holding the wrong kind of value";
+      case errc::no_script:
+        return "no matching script";
+      case errc::unexpected_reply:
+        return "unexpected reply type";
+      case errc::decompression_failed:
+        return "corrupt compressed value or unknown codec";
+      case errc::timeout:
+        return "command timed out";
+      case errc::handshake_failed:
+        return "connection handshake failed";
+      case errc::malformed_command:
+        return "malformed or truncated command";
+    }
+
+    return "unknown error";
+  }
+};
+
+const boost::system::error_category& error_category() noexcept
+{
+  static const error_category_impl category;
+  return category;
+}
+}  // namespace redis
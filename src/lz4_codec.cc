@@ -0,0 +1,58 @@
+#include <redis/lz4_codec.hpp>
+
+#include <lz4.h>
+
+namespace redis
+{
+lz4_codec::lz4_codec(int acceleration)
+    : acceleration_(acceleration)
+{
+}
+
+uint8_t lz4_codec::id() const
+{
+  return 1;
+}
+
+bool lz4_codec::compress(std::string_view in, std::string& out) const
+{
+  if (in.size() > LZ4_MAX_INPUT_SIZE)
+    return false;
+
+  int bound = LZ4_compressBound(static_cast<int>(in.size()));
+  if (bound <= 0)
+    return false;
+
+  size_t start = out.size();
+  out.resize(start + bound);
+
+  int n = LZ4_compress_fast(in.data(), &out[start], static_cast<int>(in.size()),
+                            bound, acceleration_);
+  out.resize(n > 0 ? start + n : start);
+
+  return n > 0;
+}
+
+bool lz4_codec::decompress(std::string_view in, size_t size,
+                           std::string& out) const
+{
+  // LZ4 expands 255 times at most, a larger size comes from a corrupt header
+  // and isn't allocated
+  if (size > LZ4_MAX_INPUT_SIZE || size > in.size() * 255)
+    return false;
+
+  size_t start = out.size();
+  out.resize(start + size);
+
+  int n = LZ4_decompress_safe(in.data(), &out[start],
+                              static_cast<int>(in.size()),
+                              static_cast<int>(size));
+  if (n < 0 || static_cast<size_t>(n) != size)
+  {
+    out.resize(start);
+    return false;
+  }
+
+  return true;
+}
+}  // namespace redis
@@ -0,0 +1,89 @@
+#include <redis/message_workers.hpp>
+
+namespace redis
+{
+// number of empty polls before a worker parks itself
+static constexpr int worker_spin_count = 128;
+
+message_workers::message_workers(size_t threads, size_t queue_size)
+    : stopped_(false)
+{
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; i++)
+    workers_.push_back(std::make_unique<worker>(queue_size));
+
+  // start the threads once the vector won't move anymore
+  for (auto&& w : workers_)
+    w->thread = std::thread([this, w = w.get()]() { run(*w); });
+}
+
+message_workers::~message_workers()
+{
+  stopped_.store(true);
+
+  for (auto&& w : workers_)
+  {
+    {
+      std::lock_guard<std::mutex> lock(w->mutex);
+      w->cv.notify_one();
+    }
+
+    w->thread.join();
+  }
+}
+
+void message_workers::dispatch(size_t index,
+                               const std::shared_ptr<const message_cb>& cb,
+                               std::string&& channel, std::string&& payload)
+{
+  auto&& w = *workers_[index % workers_.size()];
+
+  message m{cb, std::move(channel), std::move(payload)};
+  while (!w.queue.try_push(m))
+    std::this_thread::yield();
+
+  // pairs with the fence in run(): either the worker sees the new message or
+  // we see it sleeping.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (w.sleeping.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(w.mutex);
+    w.cv.notify_one();
+  }
+}
+
+void message_workers::run(worker& w)
+{
+  message m;
+  int spins = 0;
+
+  for (;;)
+  {
+    if (w.queue.try_pop(m))
+    {
+      spins = 0;
+
+      (*m.cb)(std::move(m.channel), std::move(m.message));
+      m.cb.reset();
+      continue;
+    }
+
+    if (spins++ < worker_spin_count)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+
+    std::unique_lock<std::mutex> lock(w.mutex);
+    w.sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    w.cv.wait(lock, [&]() { return !w.queue.empty() || stopped_.load(); });
+    w.sleeping.store(false, std::memory_order_relaxed);
+
+    if (stopped_.load() && w.queue.empty())
+      return;
+  }
+}
+}  // namespace redis
@@ -0,0 +1,305 @@
+#include <redis/metrics.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+namespace redis
+{
+latency_histogram::latency_histogram()
+    : sum_(0)
+    , max_(0)
+{
+  for (auto&& b : buckets_)
+    b.store(0, std::memory_order_relaxed);
+}
+
+size_t latency_histogram::bucket(uint64_t ns) noexcept
+{
+  if (ns < sub_buckets)
+    return static_cast<size_t>(ns);
+
+  // the 4 bits below the highest one pick the sub bucket
+  int e = 63 - __builtin_clzll(ns);
+  return static_cast<size_t>(e - 3) * sub_buckets +
+         static_cast<size_t>((ns >> (e - 4)) & (sub_buckets - 1));
+}
+
+uint64_t latency_histogram::upper_bound(size_t i) noexcept
+{
+  if (i < sub_buckets)
+    return i;
+
+  int e      = static_cast<int>(i / sub_buckets) + 3;
+  uint64_t m = i % sub_buckets;
+
+  uint64_t lower = (sub_buckets + m) << (e - 4);
+  return lower + ((uint64_t(1) << (e - 4)) - 1);
+}
+
+void latency_histogram::record(std::chrono::nanoseconds d) noexcept
+{
+  uint64_t ns = d.count() > 0 ? static_cast<uint64_t>(d.count()) : 0;
+
+  buckets_[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(ns, std::memory_order_relaxed);
+
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (ns > max &&
+         !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+  {
+  }
+}
+
+latency_histogram::snapshot latency_histogram::get() const
+{
+  snapshot s;
+  s.buckets.resize(bucket_count);
+
+  for (size_t i = 0; i < bucket_count; i++)
+    s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+
+  // the count is taken from the buckets read, so the percentiles add up
+  for (auto b : s.buckets)
+    s.count += b;
+
+  s.sum = sum_.load(std::memory_order_relaxed);
+  s.max = max_.load(std::memory_order_relaxed);
+
+  return s;
+}
+
+std::chrono::nanoseconds latency_histogram::snapshot::percentile(
+    double q) const
+{
+  if (count == 0)
+    return std::chrono::nanoseconds(0);
+
+  auto rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+  rank      = std::clamp<uint64_t>(rank, 1, count);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++)
+  {
+    seen += buckets[i];
+    if (seen >= rank)
+      return std::chrono::nanoseconds(std::min(upper_bound(i), max));
+  }
+
+  return std::chrono::nanoseconds(max);
+}
+
+metrics::metrics()
+    : commands(0)
+    , replies(0)
+    , errors(0)
+    , lost(0)
+    , timeouts(0)
+    , bytes_written(0)
+    , bytes_read(0)
+    , connections(0)
+    , disconnections(0)
+    , queued(0)
+    , in_flight(0)
+{
+  for (auto&& c : commands_)
+    c.store(nullptr, std::memory_order_relaxed);
+
+  other_.name = "OTHER";
+}
+
+metrics::~metrics()
+{
+  for (auto&& c : commands_)
+    delete c.load(std::memory_order_relaxed);
+}
+
+metrics::command_metrics& metrics::command(std::string_view name)
+{
+  // called for every command, the name is upper cased without allocating
+  char buf[32];
+  if (name.size() > sizeof(buf))
+    return other_;
+
+  for (size_t i = 0; i < name.size(); i++)
+    buf[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(name[i])));
+
+  std::string_view upper(buf, name.size());
+
+  size_t start = std::hash<std::string_view>()(upper) % commands_.size();
+  command_metrics* created = nullptr;
+
+  for (size_t i = 0; i < commands_.size(); i++)
+  {
+    auto& slot = commands_[(start + i) % commands_.size()];
+
+    auto c = slot.load(std::memory_order_acquire);
+    if (c == nullptr)
+    {
+      if (created == nullptr)
+      {
+        created       = new command_metrics;
+        created->name = upper;
+      }
+
+      // another thread may take the slot first, for this name or another
+      if (slot.compare_exchange_strong(c, created, std::memory_order_acq_rel))
+        return *created;
+    }
+
+    if (c->name == upper)
+    {
+      delete created;
+      return *c;
+    }
+  }
+
+  delete created;
+  return other_;
+}
+
+metrics::snapshot metrics::get() const
+{
+  snapshot s;
+  s.commands       = commands.load(std::memory_order_relaxed);
+  s.replies        = replies.load(std::memory_order_relaxed);
+  s.errors         = errors.load(std::memory_order_relaxed);
+  s.lost           = lost.load(std::memory_order_relaxed);
+  s.timeouts       = timeouts.load(std::memory_order_relaxed);
+  s.bytes_written  = bytes_written.load(std::memory_order_relaxed);
+  s.bytes_read     = bytes_read.load(std::memory_order_relaxed);
+  s.connections    = connections.load(std::memory_order_relaxed);
+  s.disconnections = disconnections.load(std::memory_order_relaxed);
+  s.queued         = queued.load(std::memory_order_relaxed);
+  s.in_flight      = in_flight.load(std::memory_order_relaxed);
+  s.queue_time     = queue_time.get();
+
+  for (auto&& slot : commands_)
+  {
+    if (auto c = slot.load(std::memory_order_acquire))
+      s.latency.emplace_back(c->name, c->latency.get());
+  }
+
+  auto other = other_.latency.get();
+  if (other.count > 0)
+    s.latency.emplace_back(other_.name, std::move(other));
+
+  std::sort(s.latency.begin(), s.latency.end(),
+            [](auto&& a, auto&& b) { return a.first < b.first; });
+
+  return s;
+}
+
+// the Prometheus buckets, in seconds
+static const double prometheus_buckets[] = {0.0001, 0.00025, 0.0005, 0.001,
+                                            0.0025, 0.005,   0.01,   0.025,
+                                            0.05,   0.1,     0.25,   0.5,
+                                            1,      2.5,     5,      10};
+
+static void write_metric(std::string& out, std::string_view prefix,
+                         std::string_view name, std::string_view type,
+                         std::string_view help, std::string value)
+{
+  out.append("# HELP ").append(prefix).append("_").append(name).append(" ");
+  out.append(help).append("\n");
+  out.append("# TYPE ").append(prefix).append("_").append(name).append(" ");
+  out.append(type).append("\n");
+  out.append(prefix).append("_").append(name).append(" ");
+  out.append(value).append("\n");
+}
+
+static void write_histogram(std::string& out, const std::string& name,
+                            const std::string& labels,
+                            const latency_histogram::snapshot& h)
+{
+  std::string sep = labels.empty() ? "" : ",";
+
+  size_t i           = 0;
+  uint64_t cumulated = 0;
+
+  for (double le : prometheus_buckets)
+  {
+    auto bound = static_cast<uint64_t>(le * 1e9);
+
+    // the buckets entirely below the bound. A bucket straddling it counts
+    // in the next one, never making a latency look better than it is.
+    while (i < h.buckets.size() && latency_histogram::upper_bound(i) <= bound)
+      cumulated += h.buckets[i++];
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", le);
+
+    out += name + "_bucket{" + labels + sep + "le=\"" + buf + "\"} " +
+           std::to_string(cumulated) + "\n";
+  }
+
+  out += name + "_bucket{" + labels + sep + "le=\"+Inf\"} " +
+         std::to_string(h.count) + "\n";
+
+  char sum[32];
+  snprintf(sum, sizeof(sum), "%.9f", static_cast<double>(h.sum) / 1e9);
+
+  std::string braces = labels.empty() ? "" : "{" + labels + "}";
+  out += name + "_sum" + braces + " " + sum + "\n";
+  out += name + "_count" + braces + " " + std::to_string(h.count) + "\n";
+}
+
+void metrics::write_prometheus(std::string& out, std::string_view prefix) const
+{
+  auto s = get();
+
+  write_metric(out, prefix, "commands_total", "counter", "Commands sent.",
+               std::to_string(s.commands));
+  write_metric(out, prefix, "replies_total", "counter", "Replies received.",
+               std::to_string(s.replies));
+  write_metric(out, prefix, "errors_total", "counter", "Error replies.",
+               std::to_string(s.errors));
+  write_metric(out, prefix, "lost_total", "counter",
+               "Commands whose reply was lost with the connection.",
+               std::to_string(s.lost));
+  write_metric(out, prefix, "timeouts_total", "counter",
+               "Commands whose reply didn't arrive before their deadline.",
+               std::to_string(s.timeouts));
+  write_metric(out, prefix, "written_bytes_total", "counter",
+               "Bytes written to the server.", std::to_string(s.bytes_written));
+  write_metric(out, prefix, "read_bytes_total", "counter",
+               "Bytes read from the server.", std::to_string(s.bytes_read));
+  write_metric(out, prefix, "connections_total", "counter",
+               "Connections established, reconnections included.",
+               std::to_string(s.connections));
+  write_metric(out, prefix, "disconnections_total", "counter",
+               "Connections lost.", std::to_string(s.disconnections));
+  write_metric(out, prefix, "queued", "gauge",
+               "Commands waiting to be written.", std::to_string(s.queued));
+  write_metric(out, prefix, "in_flight", "gauge",
+               "Commands waiting for their reply.", std::to_string(s.in_flight));
+
+  std::string name = std::string(prefix) + "_queue_seconds";
+  out += "# HELP " + name + " Time from async_write to the socket write.\n";
+  out += "# TYPE " + name + " histogram\n";
+  write_histogram(out, name, "", s.queue_time);
+
+  name = std::string(prefix) + "_command_duration_seconds";
+  out += "# HELP " + name + " Time from async_write to the reply.\n";
+  out += "# TYPE " + name + " histogram\n";
+  for (auto&& [command, h] : s.latency)
+  {
+    std::string label = "command=\"";
+    for (char c : command)
+    {
+      if (c == '\\' || c == '"')
+        label += '\\';
+
+      if (c == '\n')
+        label += "\\n";
+      else
+        label += c;
+    }
+    label += '"';
+
+    write_histogram(out, name, label, h);
+  }
+}
+}  // namespace redis
@@ -0,0 +1,651 @@
+#include <redis/mock_server.hpp>
+#include <redis/resp_reader.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <future>
+#include <limits>
+
+namespace redis
+{
+using tcp        = boost::asio::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+struct mock_server::session
+{
+  // a reply waiting to be written
+  struct chunk
+  {
+    clock_type::time_point due;
+    std::string data;
+    // bytes of data already written
+    size_t offset;
+    // the connection is closed once the chunk is written
+    bool drop;
+  };
+
+  explicit session(tcp::socket s)
+      : socket(std::move(s))
+      , timer(socket.get_executor())
+  {
+  }
+
+  tcp::socket socket;
+  boost::asio::steady_timer timer;
+  bool open = true;
+
+  std::string in;
+  std::deque<chunk> out;
+  // bytes in out not written yet
+  size_t backlog = 0;
+  std::string sending;
+  bool writing = false;
+
+  std::set<std::string> channels;
+};
+
+struct mock_server::flood_state
+{
+  explicit flood_state(boost::asio::io_context& ioc)
+      : timer(ioc)
+      , sent(0)
+      , start(std::chrono::steady_clock::now())
+  {
+  }
+
+  std::string channel;
+  // the message encoded once
+  std::string message;
+  size_t left;
+  size_t per_second;
+  boost::asio::steady_timer timer;
+  // messages sent since start, the rate is kept over the whole flood
+  size_t sent;
+  std::chrono::steady_clock::time_point start;
+};
+
+static std::string upper(std::string s)
+{
+  for (auto&& c : s)
+    c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+
+  return s;
+}
+
+mock_server::mock_server(uint32_t seed)
+    : work_(ioc_.get_executor())
+    , acceptor_(ioc_, tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0))
+    , random_(seed)
+    , floods_(0)
+    , connections_(0)
+    , commands_(0)
+    , bytes_written_(0)
+{
+  accept();
+  thread_ = std::thread([this] { ioc_.run(); });
+}
+
+mock_server::~mock_server()
+{
+  run(
+      [this]
+      {
+        acceptor_.close();
+        while (!sessions_.empty())
+          close(sessions_.front());
+      });
+
+  ioc_.stop();
+  thread_.join();
+}
+
+std::string mock_server::address() const
+{
+  return "127.0.0.1:" + std::to_string(port());
+}
+
+uint16_t mock_server::port() const
+{
+  return acceptor_.local_endpoint().port();
+}
+
+void mock_server::on(const std::string& command, reply_cb cb)
+{
+  run([&] { scripts_[upper(command)] = std::move(cb); });
+}
+
+void mock_server::on(const std::string& command, const std::string& reply)
+{
+  on(command, [reply](const args&) { return reply; });
+}
+
+void mock_server::set_write_options(const write_options& options)
+{
+  run([&] { options_ = options; });
+}
+
+void mock_server::drop_next_reply(size_t bytes)
+{
+  run([&] { drop_after_ = bytes; });
+}
+
+void mock_server::disconnect()
+{
+  run(
+      [this]
+      {
+        while (!sessions_.empty())
+          close(sessions_.front());
+      });
+}
+
+void mock_server::flood(const std::string& channel, const std::string& message,
+                        size_t count, size_t per_second)
+{
+  auto f        = std::make_shared<flood_state>(ioc_);
+  f->channel    = channel;
+  f->message    = array({bulk("message"), bulk(channel), bulk(message)});
+  f->left       = count;
+  f->per_second = per_second;
+
+  floods_++;
+  boost::asio::post(ioc_, [this, f] { flood_tick(f); });
+}
+
+bool mock_server::flooding() const
+{
+  return floods_ > 0;
+}
+
+mock_server::stats mock_server::get_stats() const
+{
+  return {connections_, commands_, bytes_written_};
+}
+
+std::string mock_server::simple(std::string_view s)
+{
+  return "+" + std::string(s) + "\r\n";
+}
+
+std::string mock_server::error(std::string_view s)
+{
+  return "-" + std::string(s) + "\r\n";
+}
+
+std::string mock_server::integer(int64_t n)
+{
+  return ":" + std::to_string(n) + "\r\n";
+}
+
+std::string mock_server::bulk(std::string_view s)
+{
+  return "$" + std::to_string(s.size()) + "\r\n" + std::string(s) + "\r\n";
+}
+
+std::string mock_server::nil()
+{
+  return "$-1\r\n";
+}
+
+std::string mock_server::array(const std::vector<std::string>& encoded)
+{
+  std::string out = "*" + std::to_string(encoded.size()) + "\r\n";
+  for (auto&& e : encoded)
+    out += e;
+
+  return out;
+}
+
+void mock_server::run(std::function<void()> f)
+{
+  if (ioc_.get_executor().running_in_this_thread())
+    return f();
+
+  std::promise<void> done;
+  boost::asio::post(ioc_,
+                    [&]
+                    {
+                      f();
+                      done.set_value();
+                    });
+
+  done.get_future().wait();
+}
+
+void mock_server::accept()
+{
+  acceptor_.async_accept(
+      [this](boost::system::error_code ec, tcp::socket socket)
+      {
+        if (ec)
+          return;
+
+        socket.set_option(tcp::no_delay(true));
+        connections_++;
+
+        sessions_.push_back(std::make_shared<session>(std::move(socket)));
+        read(sessions_.back());
+        accept();
+      });
+}
+
+void mock_server::read(const std::shared_ptr<session>& s)
+{
+  size_t n = s->in.size();
+  s->in.resize(n + DEFAULT_MOCK_READ_SIZE);
+
+  s->socket.async_read_some(
+      boost::asio::buffer(&s->in[n], DEFAULT_MOCK_READ_SIZE),
+      [this, s, n](boost::system::error_code ec, size_t bytes)
+      {
+        s->in.resize(n + bytes);
+
+        if (ec)
+          return close(s);
+
+        handle(s);
+        if (s->open)
+          read(s);
+      });
+}
+
+void mock_server::handle(const std::shared_ptr<session>& s)
+{
+  resp_reader r(s->in.data(), s->in.size());
+  size_t done = 0;
+
+  resp_reader::value header;
+  while (s->open && r.next(header))
+  {
+    args a;
+    resp_reader::value v;
+
+    for (int64_t i = 0; header.type == '*' && i < header.size && r.next(v); i++)
+      a.emplace_back(v.data);
+
+    // the rest of the command is yet to come
+    if (header.type == '*' && a.size() != static_cast<size_t>(header.size))
+      break;
+    done = r.position();
+
+    if (a.empty())
+      continue;
+
+    a[0] = upper(std::move(a[0]));
+    commands_++;
+
+    auto reply = execute(s, a);
+    if (!reply.empty())
+      send(*s, std::move(reply));
+  }
+
+  s->in.erase(0, done);
+  write(s);
+}
+
+std::string mock_server::execute(const std::shared_ptr<session>& s, args& a)
+{
+  auto script = scripts_.find(a[0]);
+  if (script != scripts_.end())
+    return script->second(a);
+
+  const auto& name = a[0];
+  auto arity       = [&](size_t n) { return a.size() >= n; };
+  auto wrong_arity = [&]
+  { return error("ERR wrong number of arguments for '" + name + "' command"); };
+
+  if (name == "PING")
+    return a.size() > 1 ? bulk(a[1]) : simple("PONG");
+
+  if (name == "ECHO")
+    return arity(2) ? bulk(a[1]) : wrong_arity();
+
+  if (name == "AUTH" || name == "SELECT")
+    return simple("OK");
+
+  if (name == "GET")
+  {
+    if (!arity(2))
+      return wrong_arity();
+
+    auto it = store_.find(a[1]);
+    return it != store_.end() ? bulk(it->second) : nil();
+  }
+
+  if (name == "SET")
+  {
+    if (!arity(3))
+      return wrong_arity();
+
+    store_[a[1]] = std::move(a[2]);
+    return simple("OK");
+  }
+
+  if (name == "MGET")
+  {
+    if (!arity(2))
+      return wrong_arity();
+
+    std::vector<std::string> values;
+    for (size_t i = 1; i < a.size(); i++)
+    {
+      auto it = store_.find(a[i]);
+      values.push_back(it != store_.end() ? bulk(it->second) : nil());
+    }
+
+    return array(values);
+  }
+
+  if (name == "MSET")
+  {
+    if (!arity(3) || a.size() % 2 == 0)
+      return wrong_arity();
+
+    for (size_t i = 1; i + 1 < a.size(); i += 2)
+      store_[a[i]] = std::move(a[i + 1]);
+
+    return simple("OK");
+  }
+
+  if (name == "DEL" || name == "EXISTS")
+  {
+    if (!arity(2))
+      return wrong_arity();
+
+    int64_t n = 0;
+    for (size_t i = 1; i < a.size(); i++)
+      n += name == "DEL" ? store_.erase(a[i]) : store_.count(a[i]);
+
+    return integer(n);
+  }
+
+  if (name == "INCR")
+  {
+    if (!arity(2))
+      return wrong_arity();
+
+    auto& value = store_[a[1]];
+    int64_t n   = 0;
+
+    auto end = value.data() + value.size();
+    if (!value.empty() &&
+        std::from_chars(value.data(), end, n).ptr != end)
+      return error("ERR value is not an integer or out of range");
+
+    value = std::to_string(++n);
+    return integer(n);
+  }
+
+  if (name == "SUBSCRIBE" || name == "UNSUBSCRIBE")
+  {
+    bool subscribe = name == "SUBSCRIBE";
+    if (subscribe && !arity(2))
+      return wrong_arity();
+
+    std::vector<std::string> channels(a.begin() + 1, a.end());
+    if (channels.empty())
+      channels.assign(s->channels.begin(), s->channels.end());
+
+    std::string out;
+    for (auto&& channel : channels)
+    {
+      if (subscribe)
+      {
+        s->channels.insert(channel);
+        channels_[channel].insert(s);
+      }
+      else
+      {
+        s->channels.erase(channel);
+        channels_[channel].erase(s);
+      }
+
+      out += array({bulk(subscribe ? "subscribe" : "unsubscribe"),
+                    bulk(channel),
+                    integer(static_cast<int64_t>(s->channels.size()))});
+    }
+
+    return out;
+  }
+
+  if (name == "PUBLISH")
+  {
+    if (!arity(3))
+      return wrong_arity();
+
+    auto message = array({bulk("message"), bulk(a[1]), bulk(a[2])});
+    return integer(static_cast<int64_t>(publish(a[1], message)));
+  }
+
+  return error("ERR unknown command '" + name + "'");
+}
+
+size_t mock_server::publish(const std::string& channel,
+                            const std::string& message)
+{
+  auto it = channels_.find(channel);
+  if (it == channels_.end())
+    return 0;
+
+  for (auto&& subscriber : it->second)
+  {
+    send(*subscriber, message);
+    write(subscriber);
+  }
+
+  return it->second.size();
+}
+
+void mock_server::send(session& s, std::string reply)
+{
+  auto due = clock_type::time_point::min();
+
+  if (options_.latency.count() > 0 || options_.jitter.count() > 0)
+  {
+    auto delay = options_.latency;
+    if (options_.jitter.count() > 0)
+    {
+      std::uniform_int_distribution<int64_t> jitter(0, options_.jitter.count());
+      delay += std::chrono::microseconds(jitter(random_));
+    }
+
+    due = clock_type::now() + delay;
+  }
+
+  // a reply never overtakes the previous one
+  if (!s.out.empty())
+    due = std::max(due, s.out.back().due);
+
+  bool drop = false;
+  if (drop_after_)
+  {
+    reply.resize(std::min(reply.size(), *drop_after_));
+    drop_after_.reset();
+    drop = true;
+  }
+
+  s.backlog += reply.size();
+
+  // replies due at the same time are written together
+  if (!drop && !s.out.empty() && s.out.back().due == due && !s.out.back().drop)
+  {
+    s.out.back().data += reply;
+    return;
+  }
+
+  s.out.push_back({due, std::move(reply), 0, drop});
+}
+
+void mock_server::write(const std::shared_ptr<session>& s)
+{
+  if (s->writing || !s->open || s->out.empty())
+    return;
+  s->writing = true;
+
+  auto now = clock_type::now();
+  if (s->out.front().due > now)
+  {
+    s->timer.expires_at(s->out.front().due);
+    s->timer.async_wait(
+        [this, s](boost::system::error_code ec)
+        {
+          s->writing = false;
+          if (!ec)
+            write(s);
+        });
+
+    return;
+  }
+
+  size_t limit = std::numeric_limits<size_t>::max();
+  if (options_.split > 0)
+  {
+    limit = options_.split;
+    if (options_.random_split)
+      limit = std::uniform_int_distribution<size_t>(1, options_.split)(random_);
+  }
+
+  // every reply due so far, up to the split size
+  s->sending.clear();
+  bool drop = false;
+
+  while (!s->out.empty() && s->out.front().due <= now &&
+         s->sending.size() < limit && !drop)
+  {
+    auto& c  = s->out.front();
+    size_t n = std::min(limit - s->sending.size(), c.data.size() - c.offset);
+
+    s->sending.append(c.data, c.offset, n);
+    c.offset += n;
+
+    if (c.offset == c.data.size())
+    {
+      drop = c.drop;
+      s->out.pop_front();
+    }
+  }
+
+  s->backlog -= s->sending.size();
+
+  boost::asio::async_write(
+      s->socket, boost::asio::buffer(s->sending),
+      [this, s, drop](boost::system::error_code ec, size_t bytes)
+      {
+        s->writing = false;
+        bytes_written_ += bytes;
+
+        if (ec || drop)
+          return close(s);
+
+        if (options_.split > 0 && options_.split_delay.count() > 0 &&
+            !s->out.empty())
+        {
+          s->writing = true;
+          s->timer.expires_after(options_.split_delay);
+          s->timer.async_wait(
+              [this, s](boost::system::error_code ec)
+              {
+                s->writing = false;
+                if (!ec)
+                  write(s);
+              });
+
+          return;
+        }
+
+        write(s);
+      });
+}
+
+void mock_server::close(const std::shared_ptr<session>& ref)
+{
+  // ref may be the element of sessions_ removed below
+  auto s = ref;
+
+  if (!s->open)
+    return;
+  s->open = false;
+
+  boost::system::error_code ec;
+  s->socket.shutdown(tcp::socket::shutdown_both, ec);
+  s->socket.close(ec);
+  s->timer.cancel();
+
+  for (auto&& channel : s->channels)
+    channels_[channel].erase(s);
+
+  sessions_.remove(s);
+}
+
+void mock_server::flood_tick(std::shared_ptr<flood_state> f)
+{
+  auto& subscribers = channels_[f->channel];
+
+  bool full = std::any_of(subscribers.begin(), subscribers.end(),
+                          [](auto&& s)
+                          { return s->backlog >= DEFAULT_MOCK_FLOOD_BACKLOG; });
+
+  size_t n = 0;
+  if (!full)
+  {
+    // the messages due by now at the rate, or 64KB when there is none
+    n = std::max<size_t>(1, 65536 / f->message.size());
+    if (f->per_second > 0)
+    {
+      auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - f->start);
+      // the first one goes straight away
+      auto due = static_cast<size_t>(static_cast<double>(f->per_second) *
+                                     elapsed.count() / 1e6) +
+                 1;
+
+      n = due > f->sent ? due - f->sent : 0;
+    }
+    n = std::min(n, f->left);
+  }
+
+  if (n > 0)
+  {
+    std::string batch;
+    batch.reserve(n * f->message.size());
+    for (size_t i = 0; i < n; i++)
+      batch += f->message;
+
+    for (auto&& subscriber : subscribers)
+    {
+      send(*subscriber, batch);
+      write(subscriber);
+    }
+
+    f->left -= n;
+    f->sent += n;
+  }
+
+  if (f->left == 0)
+  {
+    floods_--;
+    return;
+  }
+
+  if (!full && f->per_second == 0)
+    return boost::asio::post(ioc_, [this, f] { flood_tick(f); });
+
+  // every millisecond, or as often as a message is due if less
+  auto interval = std::chrono::microseconds(50);
+  if (f->per_second > 0)
+    interval = std::max(std::chrono::microseconds(1000),
+                        std::chrono::microseconds(1000000 / f->per_second));
+
+  f->timer.expires_after(interval);
+  f->timer.async_wait(
+      [this, f](boost::system::error_code ec)
+      {
+        if (!ec)
+          flood_tick(f);
+      });
+}
+}  // namespace redis
@@ -1,4 +1,5 @@
 #include <redis/parser.hpp>
+#include <redis/byte_scan.hpp>
 
 namespace redis
 {
@@ -18,7 +19,7 @@ size_t parser::parse(const char* s, size_t n)
     {
       types::string v;
       i += v.parse(&s[i], n - i);
-      if (!(need_more_ = !v))
+      if (!(need_more_ = !v.complete()))
         type_ = v;
       break;
     }
@@ -27,7 +28,7 @@ size_t parser::parse(const char* s, size_t n)
     {
       types::integer v;
       i += v.parse(&s[i], n - i);
-      if (!(need_more_ = !v))
+      if (!(need_more_ = !v.complete()))
         type_ = v;
       break;
     }
@@ -36,7 +37,7 @@ size_t parser::parse(const char* s, size_t n)
     {
       types::error v;
       i += v.parse(&s[i], n - i);
-      if (!(need_more_ = !v))
+      if (!(need_more_ = !v.complete()))
         type_ = v;
       break;
     }
@@ -45,12 +46,12 @@ size_t parser::parse(const char* s, size_t n)
     {
       types::vector v;
       i += v.parse(&s[i], n - i);
-      if (!(need_more_ = !v))
+      if (!(need_more_ = !v.complete()))
         type_ = v;
       break;
     }
 
-    i++;
+    i += find_prefix(&s[i], n - i);
   }
   // TODO: need_more_ = need_more_ || i == n;
 
@@ -0,0 +1,156 @@
+#include <redis/resp_reader.hpp>
+#include <redis/byte_scan.hpp>
+
+namespace redis
+{
+static int64_t to_int64(std::string_view s)
+{
+  int64_t v     = 0;
+  bool negative = !s.empty() && s[0] == '-';
+
+  for (size_t i = negative ? 1 : 0; i < s.size(); i++)
+    v = v * 10 + (s[i] - '0');
+
+  return negative ? -v : v;
+}
+
+resp_reader::resp_reader(const char* s, size_t n)
+    : s_(s)
+    , n_(n)
+    , i_(0)
+    , missing_(0)
+{
+}
+
+size_t resp_reader::missing(const char* s, size_t n)
+{
+  resp_reader r(s, n);
+  if (r.skip())
+    return 0;
+
+  return r.missing_;
+}
+
+bool resp_reader::next(value& v)
+{
+  if (i_ >= n_)
+    return false;
+
+  missing_  = 0;
+  v.type    = s_[i_++];
+  v.size    = 0;
+  v.is_null = false;
+  v.data    = {};
+
+  std::string_view l;
+  if (!line(l))
+    return false;
+
+  switch (v.type)
+  {
+    case '+':
+    case '-':
+      v.data = l;
+      v.size = l.size();
+      break;
+    case ':':
+      v.size = to_int64(l);
+      break;
+    case '*':
+      v.size    = to_int64(l);
+      v.is_null = v.size < 0;
+      break;
+    case '$':
+      v.size = to_int64(l);
+      if ((v.is_null = v.size < 0))
+        break;
+
+      // the payload is binary, jump over it using the declared length
+      if (n_ - i_ < static_cast<size_t>(v.size) + 2)
+      {
+        missing_ = v.size + 2 - (n_ - i_);
+        return false;
+      }
+
+      v.data = std::string_view(&s_[i_], v.size);
+      i_ += v.size + 2;
+      break;
+    default:
+      // not a RESP type
+      return false;
+  }
+
+  return true;
+}
+
+bool resp_reader::skip()
+{
+  // elements left to skip, arrays add theirs as they are found
+  int64_t left = 1;
+
+  value v;
+  while (left > 0)
+  {
+    if (!next(v))
+      return false;
+
+    left--;
+    if (v.type == '*' && v.size > 0)
+      left += v.size;
+  }
+
+  return true;
+}
+
+bool resp_reader::skip(value& v)
+{
+  if (!next(v))
+    return false;
+
+  for (int64_t i = 0; v.type == '*' && i < v.size; i++)
+  {
+    if (!skip())
+      return false;
+  }
+
+  return true;
+}
+
+size_t reply_scanner::scan(const char* s, size_t n)
+{
+  size_t start = scanned_;
+  resp_reader r(s + start, n - start);
+
+  resp_reader::value v;
+  while (left_ > 0)
+  {
+    if (!r.next(v))
+    {
+      missing_ = r.missing_;
+      return 0;
+    }
+
+    scanned_ = start + r.position();
+    left_--;
+    if (v.type == '*' && v.size > 0)
+      left_ += v.size;
+  }
+
+  size_t size = scanned_;
+  reset();
+
+  return size;
+}
+
+bool resp_reader::line(std::string_view& l)
+{
+  size_t end = i_ + find_crlf(&s_[i_], n_ - i_);
+  if (end == n_)
+    return false;
+
+  l  = std::string_view(&s_[i_], end - i_);
+  i_ = end + 2;
+
+  return true;
+}
+}  // namespace redis
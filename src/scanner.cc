@@ -0,0 +1,166 @@
+#include <redis/scanner.hpp>
+
+namespace redis
+{
+scanner::scanner(redis::stream& s, command cmd, const std::string& key)
+    : stream_(s)
+    , command_(cmd)
+    , key_(key)
+    , count_(0)
+    , cursor_("0")
+    , has_ready_(false)
+    , in_flight_(false)
+    , finished_(false)
+    , generation_(0)
+{
+}
+
+void scanner::async_next(page_cb cb)
+{
+  if (has_ready_)
+  {
+    has_ready_ = false;
+
+    scan_page page = std::move(ready_);
+    cb(page);
+    return;
+  }
+
+  if (finished_)
+  {
+    scan_page page{{}, true, {}};
+    cb(page);
+    return;
+  }
+
+  waiting_cb_ = cb;
+  request();
+}
+
+void scanner::reset()
+{
+  generation_++;
+
+  cursor_    = "0";
+  has_ready_ = false;
+  in_flight_ = false;
+  finished_  = false;
+
+  ready_.items.clear();
+  waiting_cb_ = nullptr;
+}
+
+void scanner::request()
+{
+  if (in_flight_ || finished_)
+    return;
+  in_flight_ = true;
+
+  std::vector<std::string> args;
+  args.reserve(9);
+
+  switch (command_)
+  {
+    case command::scan:
+      args.push_back("SCAN");
+      break;
+    case command::hscan:
+      args.push_back("HSCAN");
+      break;
+    case command::sscan:
+      args.push_back("SSCAN");
+      break;
+    case command::zscan:
+      args.push_back("ZSCAN");
+      break;
+  }
+
+  if (command_ != command::scan)
+    args.push_back(key_);
+
+  args.push_back(cursor_);
+
+  if (!match_.empty())
+  {
+    args.push_back("MATCH");
+    args.push_back(match_);
+  }
+
+  if (count_ > 0)
+  {
+    args.push_back("COUNT");
+    args.push_back(std::to_string(count_));
+  }
+
+  if (!type_.empty() && command_ == command::scan)
+  {
+    args.push_back("TYPE");
+    args.push_back(type_);
+  }
+
+  stream_.async_write([this, generation = generation_](auto&& reply)
+                      { on_reply(std::move(reply), generation); },
+                      args);
+}
+
+void scanner::on_reply(any_type reply, size_t generation)
+{
+  if (generation != generation_)
+    return;
+
+  in_flight_ = false;
+
+  scan_page page{{}, false, {}};
+
+  // [cursor, [items...]]
+  auto v = boost::variant2::get_if<redis::types::vector>(&reply);
+  if (v != nullptr && (**v).size() == 2)
+  {
+    auto&& vs     = **v;
+    auto cursor   = boost::variant2::get_if<redis::types::string>(&vs[0]);
+    auto elements = boost::variant2::get_if<redis::types::vector>(&vs[1]);
+
+    if (cursor != nullptr)
+      cursor_ = std::move(**cursor);
+
+    if (elements != nullptr)
+    {
+      page.items.reserve((**elements).size());
+      for (auto&& e : **elements)
+      {
+        if (auto s = boost::variant2::get_if<redis::types::string>(&e))
+          page.items.push_back(std::move(**s));
+      }
+    }
+
+    page.last = cursor == nullptr || cursor_ == "0";
+  }
+  else
+  {
+    if (auto e = boost::variant2::get_if<redis::types::error>(&reply))
+      page.error = *e;
+    else
+      page.error = std::string("ERR unexpected SCAN reply");
+
+    page.last = true;
+  }
+
+  finished_ = page.last;
+
+  // keep the next page coming while this one is processed
+  request();
+
+  if (waiting_cb_)
+  {
+    auto cb = std::move(waiting_cb_);
+    waiting_cb_ = nullptr;
+
+    cb(page);
+  }
+  else
+  {
+    ready_     = std::move(page);
+    has_ready_ = true;
+  }
+}
+}  // namespace redis
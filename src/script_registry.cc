@@ -0,0 +1,84 @@
+#include <redis/script_registry.hpp>
+
+#include <openssl/evp.h>
+
+namespace redis
+{
+script_registry::script_registry(redis::stream& s)
+    : stream_(s)
+{
+  stream_.add_on_connected(
+      [this]()
+      {
+        for (auto&& script : scripts_)
+          load(script.second);
+      });
+}
+
+std::string script_registry::add(const std::string& body)
+{
+  auto sha = sha1(body);
+
+  if (scripts_.emplace(sha, body).second && stream_)
+    load(body);
+
+  return sha;
+}
+
+void script_registry::async_eval(const std::string& sha,
+                                 const std::vector<std::string>& keys,
+                                 const std::vector<std::string>& args,
+                                 stream::handler cb)
+{
+  std::vector<std::string> cmd;
+  cmd.reserve(keys.size() + args.size() + 3);
+
+  cmd.push_back("EVALSHA");
+  cmd.push_back(sha);
+  cmd.push_back(std::to_string(keys.size()));
+  cmd.insert(cmd.end(), keys.begin(), keys.end());
+  cmd.insert(cmd.end(), args.begin(), args.end());
+
+  stream_.async_write(
+      [this, cmd, cb](any_type reply)
+      {
+        auto e = boost::variant2::get_if<redis::types::error>(&reply);
+        if (e == nullptr || (**e).rfind("NOSCRIPT", 0) != 0)
+          return cb(std::move(reply));
+
+        auto script = scripts_.find(cmd[1]);
+        if (script == scripts_.end())
+          return cb(std::move(reply));
+
+        // both go in the same write, EVALSHA runs right after the load
+        load(script->second);
+        stream_.async_write(cb, cmd);
+      },
+      cmd);
+}
+
+std::string script_registry::sha1(std::string_view body)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+
+  EVP_Digest(body.data(), body.size(), digest, &size, EVP_sha1(), nullptr);
+
+  std::string sha(size * 2, '0');
+  for (unsigned int i = 0; i < size; i++)
+  {
+    sha[i * 2]     = hex[digest[i] >> 4];
+    sha[i * 2 + 1] = hex[digest[i] & 0xf];
+  }
+
+  return sha;
+}
+
+void script_registry::load(const std::string& body)
+{
+  // a failed load surfaces as NOSCRIPT on the next EVALSHA
+  stream_.async_write([](any_type) {}, "SCRIPT", "LOAD", body);
+}
+}  // namespace redis
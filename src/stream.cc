@@ -1,11 +1,52 @@
+#include <redis/resp_reader.hpp>
 #include <redis/stream.hpp>
 
+#include <algorithm>
+
 namespace redis
 {
 stream::stream(boost::asio::io_context& ioc)
     : stream_(ioc)
-    , is_sending_(false)
+    , is_connected_(false)
+    , is_writing_(false)
+    , is_reading_(false)
+    , sending_(0)
+    , missing_(0)
+    , last_id_(0)
+    , reading_id_(0)
+    , timer_(ioc)
+    , timer_expiry_(std::chrono::steady_clock::time_point::max())
+    , command_timeout_(0)
+    , recycle_after_(0)
+    , stale_(0)
+{
+  stream_.set_on_stream_closed([this](auto&& ec) { on_stream_closed(ec); });
+  stream_.set_on_reconnect(
+      [this]()
+      {
+        if (on_reconnect_cb_)
+          on_reconnect_cb_();
+
+        on_connected();
+      });
+}
+
+stream::~stream()
 {
+  for (auto&& req : queue_)
+  {
+    if (req.handler)
+      req.handler->destroy();
+  }
+
+  for (auto&& l : lanes_)
+  {
+    for (auto&& req : l.requests)
+    {
+      if (req.handler)
+        req.handler->destroy();
+    }
+  }
 }
 
 auto stream::get_executor() -> basic_stream::asio_stream::executor_type
@@ -13,37 +54,607 @@ auto stream::get_executor() -> basic_stream::asio_stream::executor_type
   return stream_.get_executor();
 }
 
+void stream::set_metrics(std::shared_ptr<metrics> m)
+{
+  // the commands measured so far stop being measured, leaving the gauges of
+  // the previous metrics as if they were done
+  for (auto&& req : queue_)
+  {
+    if (req.measured)
+      metrics_->in_flight--;
+    req.measured = nullptr;
+  }
+
+  for (auto&& l : lanes_)
+  {
+    for (auto&& req : l.requests)
+    {
+      if (req.measured)
+        metrics_->queued--;
+      req.measured = nullptr;
+    }
+  }
+
+  metrics_ = std::move(m);
+}
+
 void stream::connect(const std::string& hostport)
 {
   stream_.connect(hostport);
+  on_connected();
 }
 
 void stream::connect(const std::string& hostport, boost::system::error_code& ec) noexcept
 {
   stream_.connect(hostport, ec);
+  if (!ec)
+    on_connected();
 }
 
 void stream::connect(const std::string& host, const std::string& port)
 {
   stream_.connect(host, port);
+  on_connected();
 }
 
 void stream::connect(const std::string& host, const std::string& port,
                      boost::system::error_code& ec) noexcept
 {
   stream_.connect(host, port, ec);
+  if (!ec)
+    on_connected();
+}
+
+void stream::on_connected()
+{
+  is_connected_ = true;
+
+  if (metrics_)
+    metrics_->connections++;
+
+  for (auto&& cb : on_connected_cbs_)
+    cb();
+
+  // flush whatever was queued while there was no connection
+  write();
+}
+
+void stream::on_stream_closed(boost::system::error_code ec)
+{
+  is_connected_ = false;
+
+  // the replies of the commands already sent are lost. Commands still in
+  // the lanes are sent once reconnected.
+  if (metrics_)
+    metrics_->disconnections++;
+
+  while (!queue_.empty())
+  {
+    auto handler = queue_.front().handler;
+
+    if (queue_.front().measured && handler)
+      metrics_->lost++;
+    pop_front();
+
+    // timed out already
+    if (!handler)
+    {
+      stale_--;
+      continue;
+    }
+
+    handler->lost();
+    handler->complete();
+  }
+
+  read_buffer_.consume(read_buffer_.size());
+  missing_ = 0;
+  scanner_.reset();
+
+  if (on_stream_closed_cb_)
+    on_stream_closed_cb_(ec);
+}
+
+void stream::write()
+{
+  if (is_writing_ || !is_connected_)
+    return;
+
+  // the lanes by priority, each as far as its limit allows
+  size_t first = queue_.size();
+  for (auto&& l : lanes_)
+    take(l);
+
+  send(first);
+}
+
+void stream::send(size_t first)
+{
+  sending_ = queue_.size() - first;
+  if (sending_ == 0)
+    return;
+  is_writing_ = true;
+
+  if (metrics_)
+  {
+    auto now = std::chrono::steady_clock::now();
+
+    for (size_t i = first; i < queue_.size(); i++)
+    {
+      if (!queue_[i].measured)
+        continue;
+
+      metrics_->queue_time.record(now - queue_[i].enqueued);
+      metrics_->queued--;
+      metrics_->in_flight++;
+    }
+  }
+
+  if constexpr (trace::enabled)
+    trace_write(trace::event_type::write_started, first, sending_, {});
+
+  stream_.async_write(
+      boost::asio::buffer(sending_buffer_),
+      [this](auto&& ec, size_t bytes_written)
+      {
+        if (metrics_)
+          metrics_->bytes_written += bytes_written;
+
+        // the replies of the first commands may have arrived already
+        if constexpr (trace::enabled)
+        {
+          size_t count = std::min(sending_, queue_.size());
+          trace_write(trace::event_type::write_completed,
+                      queue_.size() - count, count, ec);
+        }
+
+        on_write();
+      });
+
+  read();
+}
+
+void stream::take(lane& l)
+{
+  size_t n = l.requests.size();
+  if (l.limit > 0)
+    n = std::min(n, l.limit > l.in_flight ? l.limit - l.in_flight : 0);
+  if (n == 0)
+    return;
+
+  if (n == l.requests.size())
+  {
+    // new commands keep going to the lane while this one is written
+    if (sending_buffer_.empty())
+      std::swap(l.buffer, sending_buffer_);
+    else
+      sending_buffer_ += l.buffer;
+
+    l.buffer.clear();
+    l.command_start = 0;
+  }
+  else
+  {
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++)
+      bytes += l.requests[i].bytes;
+
+    sending_buffer_.append(l.buffer, 0, bytes);
+    l.buffer.erase(0, bytes);
+    l.command_start -= bytes;
+  }
+
+  l.in_flight += n;
+  for (size_t i = 0; i < n; i++)
+  {
+    // expired in the lane, its reply is now awaited
+    if (!l.requests.front().handler)
+      stale_++;
+
+    queue_.push_back(std::move(l.requests.front()));
+    l.requests.pop_front();
+  }
+}
+
+void stream::pop_front()
+{
+  auto& req = queue_.front();
+
+  // the reply scanned, if any, was read whole or won't be
+  scanner_.reset();
+
+  lanes_[static_cast<size_t>(req.prio)].in_flight--;
+  if (req.measured)
+    metrics_->in_flight--;
+
+  queue_.pop_front();
 }
 
-void stream::async_connect(const std::string& hostport,
-                           basic_stream::on_connect_cb cb) noexcept
+void stream::on_write()
 {
-  stream_.async_connect(hostport, cb);
+  is_writing_ = false;
+  sending_buffer_.clear();
+  sending_ = 0;
+
+  // even after a failure: the write went with its connection, the next one
+  // may be up already and waiting for it to complete
+  write();
 }
 
-void stream::async_connect(const std::string& host, const std::string& port,
-                           basic_stream::on_connect_cb cb) noexcept
+void stream::read()
 {
-  stream_.async_connect(host, port, cb);
+  // nothing to wait for
+  if (is_reading_ || queue_.empty())
+    return;
+  is_reading_ = true;
+
+  // large values are read straight into a buffer big enough for them
+  size_t size = std::max<size_t>(DEFAULT_READ_SIZE, missing_);
+
+  stream_.async_read_some(read_buffer_.prepare(size),
+                          [this](auto&& ec, size_t bytes_read)
+                          { on_read(ec, bytes_read); });
+}
+
+void stream::on_read(boost::system::error_code const& ec, size_t bytes_read)
+{
+  if (ec)
+  {
+    is_reading_ = false;
+    return;
+  }
+
+  read_buffer_.commit(bytes_read);
+
+  if (metrics_)
+    metrics_->bytes_read += bytes_read;
+
+  // no reply can be complete until the bulk string being read is
+  if (bytes_read < missing_)
+  {
+    missing_ -= bytes_read;
+    is_reading_ = false;
+    read();
+    return;
+  }
+
+  // dispatch every complete reply. is_reading_ stays set so the handlers
+  // can't start another read while read_buffer_ is being parsed.
+  while (!queue_.empty() && read_buffer_.size() > 0)
+  {
+    auto& req = queue_.front();
+
+    if constexpr (trace::enabled)
+    {
+      if (req.id != reading_id_)
+      {
+        reading_id_ = req.id;
+        trace::emit(
+            [&]
+            {
+              return trace::event{trace::event_type::first_byte, &stream_,
+                                  req.id, req.id};
+            });
+      }
+    }
+
+    // replies nobody waits for, like the +QUEUED of a transaction
+    while (req.skip > 0)
+    {
+      resp_reader r((const char*) read_buffer_.data().data(),
+                    read_buffer_.size());
+
+      resp_reader::value v;
+      if (!r.skip(v))
+        break;
+
+      if (v.type == '-' && !req.error)
+        req.error = std::string(v.data);
+
+      read_buffer_.consume(r.position());
+      scanner_.reset();
+      req.skip--;
+    }
+
+    if (req.skip > 0 || read_buffer_.size() == 0)
+      break;
+
+    // the handler completed without it, the reply is only read past
+    if (!req.handler)
+    {
+      size_t size = scanner_.scan((const char*) read_buffer_.data().data(),
+                                  read_buffer_.size());
+      if (size == 0)
+        break;
+
+      read_buffer_.consume(size);
+
+      pop_front();
+      stale_--;
+      continue;
+    }
+
+    bool is_error = *(const char*) read_buffer_.data().data() == '-';
+
+    size_t bytes_parsed = req.handler->parse(
+        parser_, scanner_, (const char*) read_buffer_.data().data(),
+        read_buffer_.size());
+    if (bytes_parsed == 0)
+      break;
+
+    read_buffer_.consume(bytes_parsed);
+
+    trace::emit(
+        [&]
+        {
+          trace::event e{trace::event_type::parsed, &stream_, req.id, req.id};
+          e.error_reply = is_error || req.error;
+          return e;
+        });
+
+    if (req.measured)
+    {
+      req.measured->latency.record(std::chrono::steady_clock::now() -
+                                  req.enqueued);
+
+      metrics_->replies++;
+      if (is_error || req.error)
+        metrics_->errors++;
+    }
+
+    auto handler = req.handler;
+    auto error   = std::move(req.error);
+    pop_front();
+
+    // a skipped error explains better why the last command failed, e.g. the
+    // command that made EXEC return EXECABORT
+    if (error)
+      handler->replace_error(error);
+
+    handler->complete();
+  }
+
+  // resumes the scan of the reply cut short, not scanning it all again
+  missing_ = 0;
+  if (!queue_.empty() && read_buffer_.size() > 0 &&
+      scanner_.scan((const char*) read_buffer_.data().data(),
+                    read_buffer_.size()) == 0)
+    missing_ = scanner_.missing();
+
+  is_reading_ = false;
+
+  // the replies may have let the commands of a limited lane through
+  write();
+  read();
+}
+
+std::string_view stream::command_name(const lane& l) const
+{
+  // the name is the first bulk string of the command
+  resp_reader r(l.buffer.data() + l.command_start,
+                l.buffer.size() - l.command_start);
+
+  resp_reader::value header, name;
+  if (!r.next(header) || header.type != '*' || !r.next(name))
+    return "OTHER";
+
+  return name.data;
+}
+
+void stream::measure(request& req, const lane& l)
+{
+  req.measured = &metrics_->command(command_name(l));
+  req.enqueued = std::chrono::steady_clock::now();
+
+  metrics_->commands++;
+  metrics_->queued++;
+}
+
+void stream::trace_enqueued(request& req, const lane& l)
+{
+  req.handler->trace_connection = &stream_;
+
+  trace::emit(
+      [&]
+      {
+        trace::event e{trace::event_type::enqueued, &stream_, req.id, req.id};
+        e.name = command_name(l);
+        return e;
+      });
+}
+
+void stream::trace_write(trace::event_type type, size_t first, size_t count,
+                         boost::system::error_code ec)
+{
+  // a write mixing lanes isn't a single range of ids
+  size_t end = first + count;
+  while (first < end)
+  {
+    size_t last  = first;
+    size_t bytes = queue_[first].bytes;
+
+    while (last + 1 < end && queue_[last + 1].id == queue_[last].id + 1)
+      bytes += queue_[++last].bytes;
+
+    trace::emit(
+        [&]
+        {
+          trace::event e{type, &stream_, queue_[first].id, queue_[last].id};
+          e.bytes = bytes;
+          e.ec    = ec;
+          return e;
+        });
+
+    first = last + 1;
+  }
+}
+
+void stream::set_deadline(request& req, duration timeout)
+{
+  req.deadline = std::chrono::steady_clock::now() + timeout;
+  arm_timer(req.deadline);
+}
+
+void stream::arm_timer(std::chrono::steady_clock::time_point deadline)
+{
+  // with the same timeout for every command the deadlines come in order and
+  // the timer is left alone, it only fires once per timeout
+  if (deadline >= timer_expiry_)
+    return;
+  timer_expiry_ = deadline;
+
+  timer_.expires_at(deadline);
+  timer_.async_wait(
+      [this](auto&& ec)
+      {
+        if (!ec)
+          on_timer();
+      });
+}
+
+void stream::on_timer()
+{
+  timer_expiry_ = std::chrono::steady_clock::time_point::max();
+
+  auto now  = std::chrono::steady_clock::now();
+  auto next = std::chrono::steady_clock::time_point::max();
+
+  // the handlers completed can send more commands, the queues may grow
+  auto check = [&](std::deque<request>& requests, bool written)
+  {
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+      auto& req = requests[i];
+      if (!req.handler)
+        continue;
+
+      if (req.deadline <= now)
+        expire(req, errc::timeout, written);
+      else
+        next = std::min(next, req.deadline);
+    }
+  };
+
+  check(queue_, true);
+  for (auto&& l : lanes_)
+    check(l.requests, false);
+
+  if (next != std::chrono::steady_clock::time_point::max())
+    arm_timer(next);
+
+  recycle_if_stuck();
+}
+
+void stream::expire(request& req, boost::system::error_code ec,
+                    bool written)
+{
+  auto handler = req.handler;
+
+  req.handler = nullptr;
+  if (written)
+    stale_++;
+
+  if (req.measured && ec == errc::timeout)
+    metrics_->timeouts++;
+
+  handler->abort(ec);
+  handler->complete();
+}
+
+void stream::cancel(uint64_t id)
+{
+  request* req = nullptr;
+  bool written = false;
+
+  // the ids grow along each lane, queue_ mixes them
+  for (auto&& l : lanes_)
+  {
+    auto it = std::lower_bound(l.requests.begin(), l.requests.end(), id,
+                               [](const request& req, uint64_t id)
+                               { return req.id < id; });
+    if (it != l.requests.end() && it->id == id)
+      req = &*it;
+  }
+
+  if (req == nullptr)
+  {
+    auto it = std::find_if(queue_.begin(), queue_.end(),
+                           [id](const request& req) { return req.id == id; });
+    if (it != queue_.end())
+    {
+      req     = &*it;
+      written = true;
+    }
+  }
+
+  if (req == nullptr || !req->handler)
+    return;
+
+  expire(*req, boost::asio::error::operation_aborted, written);
+  recycle_if_stuck();
+}
+
+void stream::recycle_if_stuck()
+{
+  if (recycle_after_ == 0 || stale_ < recycle_after_ || !is_connected_)
+    return;
+
+  // the commands in flight fail, those still to write are sent on the new
+  // connection
+  stream_.recycle(errc::timeout);
+}
+
+void stream::write_exec(const transaction& tx)
+{
+  static const std::string_view multi = "*1\r\n$5\r\nMULTI\r\n";
+  static const std::string_view exec  = "*1\r\n$4\r\nEXEC\r\n";
+
+  auto& out = buffer(priority::normal);
+
+  out.append(multi);
+  out += tx.data();
+  out.append(exec);
+}
+
+void stream::attempt(std::shared_ptr<optimistic_transaction> state)
+{
+  state->tx.clear();
+  state->attempts_left--;
+
+  async_write(
+      [this, state](any_type reply)
+      {
+        if (boost::variant2::holds_alternative<redis::types::error>(reply))
+          return finish(state, std::move(reply));
+
+        // EXEC also runs an empty transaction, releasing the WATCH
+        state->prepare(state->tx,
+                       [this, state]()
+                       {
+                         async_exec(state->tx,
+                                    [this, state](transaction_result result)
+                                    {
+                                      if (result.aborted() &&
+                                          state->attempts_left > 0)
+                                      {
+                                        return attempt(state);
+                                      }
+
+                                      finish(state, std::move(result.reply()));
+                                    });
+                       });
+      },
+      state->watch);
+}
+
+void stream::finish(std::shared_ptr<optimistic_transaction> state,
+                    any_type reply)
+{
+  auto done   = state->done;
+  state->done = nullptr;
+
+  done->assign(std::move(reply));
+  done->complete();
 }
 
 }  // namespace redis
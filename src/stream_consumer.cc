@@ -0,0 +1,424 @@
+#include <redis/stream_consumer.hpp>
+
+#include <algorithm>
+
+namespace redis
+{
+static void append_header(std::string& out, char type, size_t n)
+{
+  out += type;
+  out += std::to_string(n);
+  out += "\r\n";
+}
+
+static void append_bulk(std::string& out, std::string_view s)
+{
+  append_header(out, '$', s.size());
+  out.append(s);
+  out += "\r\n";
+}
+
+void stream_batch::clear()
+{
+  entries_.clear();
+  fields_.clear();
+  error_ = {};
+}
+
+bool stream_batch::parse(resp_reader& r)
+{
+  resp_reader::value streams;
+  if (!r.next(streams))
+    return false;
+
+  if (streams.type == '-')
+  {
+    error_ = streams.data;
+    return true;
+  }
+
+  // nil when BLOCK timed out
+  if (streams.type != '*' || streams.is_null)
+    return true;
+
+  // [[key, [[id, [field, value, ...]], ...]], ...]
+  for (int64_t i = 0; i < streams.size; i++)
+  {
+    resp_reader::value stream, key, entries;
+    if (!r.next(stream) || !r.next(key) || !r.next(entries))
+      return false;
+
+    for (int64_t j = 0; j < entries.size; j++)
+    {
+      resp_reader::value entry, id, fields;
+      if (!r.next(entry) || !r.next(id) || !r.next(fields))
+        return false;
+
+      // fields are nil when the entry was deleted while pending
+      size_t pairs = fields.size > 0 ? fields.size / 2 : 0;
+      for (size_t k = 0; k < pairs; k++)
+      {
+        resp_reader::value field, value;
+        if (!r.next(field) || !r.next(value))
+          return false;
+
+        fields_.emplace_back(field.data, value.data);
+      }
+
+      entries_.push_back({key.data, id.data, nullptr, pairs});
+    }
+  }
+
+  // fields_ is final now, point every entry to its fields
+  const stream_entry::field* fields = fields_.data();
+  for (auto&& e : entries_)
+  {
+    e.fields = fields;
+    fields += e.size;
+  }
+
+  return true;
+}
+
+stream_consumer::stream_consumer(boost::asio::io_context& ioc)
+    : stream_(ioc)
+    , retry_timer_(ioc)
+    , batch_size_(100)
+    , block_(std::chrono::seconds(5))
+    , auto_ack_(false)
+    , create_group_(true)
+    , is_running_(false)
+    , is_reading_(false)
+    , is_writing_(false)
+{
+  stream_.set_on_reconnect(
+      [this]()
+      {
+        if (is_running_)
+          restart();
+      });
+}
+
+auto stream_consumer::get_executor() -> basic_stream::asio_stream::executor_type
+{
+  return stream_.get_executor();
+}
+
+void stream_consumer::connect(const std::string& hostport)
+{
+  stream_.connect(hostport);
+}
+
+void stream_consumer::connect(const std::string& hostport,
+                              boost::system::error_code& ec) noexcept
+{
+  stream_.connect(hostport, ec);
+}
+
+void stream_consumer::connect(const std::string& host, const std::string& port)
+{
+  stream_.connect(host, port);
+}
+
+void stream_consumer::connect(const std::string& host, const std::string& port,
+                              boost::system::error_code& ec) noexcept
+{
+  stream_.connect(host, port, ec);
+}
+
+void stream_consumer::async_connect(const std::string& hostport,
+                                    basic_stream::on_connect_cb cb) noexcept
+{
+  stream_.async_connect(hostport, cb);
+}
+
+void stream_consumer::async_connect(const std::string& host,
+                                    const std::string& port,
+                                    basic_stream::on_connect_cb cb) noexcept
+{
+  stream_.async_connect(host, port, cb);
+}
+
+void stream_consumer::consume(const std::string& group,
+                              const std::string& consumer,
+                              const std::vector<std::string>& streams,
+                              batch_cb cb)
+{
+  group_       = group;
+  consumer_    = consumer;
+  on_batch_cb_ = cb;
+
+  streams_.clear();
+  for (auto&& key : streams)
+    streams_.push_back({key, "0", {}, 0});
+
+  is_running_ = true;
+  restart();
+}
+
+void stream_consumer::ack(const stream_entry& entry)
+{
+  ack(entry.stream, entry.id);
+}
+
+void stream_consumer::ack(std::string_view stream, std::string_view id)
+{
+  auto s = find(stream);
+  if (s == nullptr)
+    return;
+
+  append_bulk(s->acks, id);
+  s->ack_count++;
+}
+
+void stream_consumer::stop()
+{
+  is_running_ = false;
+
+  // nothing will trigger the next round if there is no XREADGROUP waiting
+  if (std::find(expected_.begin(), expected_.end(), reply_kind::read) ==
+      expected_.end())
+  {
+    retry_timer_.cancel();
+    round(false);
+  }
+}
+
+auto stream_consumer::find(std::string_view key) -> stream_state*
+{
+  for (auto&& s : streams_)
+  {
+    if (s.key == key)
+      return &s;
+  }
+
+  return nullptr;
+}
+
+void stream_consumer::restart()
+{
+  expected_.clear();
+  write_buffer_.clear();
+  read_buffer_.consume(read_buffer_.size());
+
+  // read back what was delivered to us but never acknowledged
+  for (auto&& s : streams_)
+    s.id = "0";
+
+  if (create_group_)
+  {
+    for (auto&& s : streams_)
+    {
+      append_header(write_buffer_, '*', 6);
+      append_bulk(write_buffer_, "XGROUP");
+      append_bulk(write_buffer_, "CREATE");
+      append_bulk(write_buffer_, s.key);
+      append_bulk(write_buffer_, group_);
+      append_bulk(write_buffer_, "$");
+      append_bulk(write_buffer_, "MKSTREAM");
+
+      expected_.push_back(reply_kind::group);
+    }
+  }
+
+  round(true);
+}
+
+void stream_consumer::round(bool read_entries)
+{
+  for (auto&& s : streams_)
+  {
+    if (s.ack_count == 0)
+      continue;
+
+    append_header(write_buffer_, '*', 3 + s.ack_count);
+    append_bulk(write_buffer_, "XACK");
+    append_bulk(write_buffer_, s.key);
+    append_bulk(write_buffer_, group_);
+    write_buffer_.append(s.acks);
+
+    s.acks.clear();
+    s.ack_count = 0;
+
+    expected_.push_back(reply_kind::ack);
+  }
+
+  if (read_entries)
+  {
+    // BLOCK is ignored by the server while reading pending entries
+    bool blocking = std::all_of(streams_.begin(), streams_.end(),
+                                [](auto&& s) { return s.id == ">"; });
+
+    append_header(write_buffer_, '*',
+                  7 + (blocking ? 2 : 0) + 2 * streams_.size());
+    append_bulk(write_buffer_, "XREADGROUP");
+    append_bulk(write_buffer_, "GROUP");
+    append_bulk(write_buffer_, group_);
+    append_bulk(write_buffer_, consumer_);
+    append_bulk(write_buffer_, "COUNT");
+    append_bulk(write_buffer_, std::to_string(batch_size_));
+    if (blocking)
+    {
+      append_bulk(write_buffer_, "BLOCK");
+      append_bulk(write_buffer_, std::to_string(block_.count()));
+    }
+    append_bulk(write_buffer_, "STREAMS");
+    for (auto&& s : streams_)
+      append_bulk(write_buffer_, s.key);
+    for (auto&& s : streams_)
+      append_bulk(write_buffer_, s.id);
+
+    expected_.push_back(reply_kind::read);
+  }
+
+  write();
+  read();
+}
+
+void stream_consumer::on_batch()
+{
+  if (!batch_.error_.empty())
+  {
+    report(batch_.error_);
+    return;
+  }
+
+  if (!batch_.empty())
+  {
+    if (on_batch_cb_)
+      on_batch_cb_(batch_);
+
+    if (auto_ack_)
+    {
+      for (auto&& e : batch_)
+        ack(e);
+    }
+  }
+
+  // keep reading pending entries after the last one received, a stream
+  // without any left moves on to new entries
+  for (auto&& s : streams_)
+  {
+    if (s.id == ">")
+      continue;
+
+    auto it = std::find_if(batch_.entries_.rbegin(), batch_.entries_.rend(),
+                           [&](auto&& e) { return e.stream == s.key; });
+    if (it == batch_.entries_.rend())
+      s.id = ">";
+    else
+      s.id = it->id;
+  }
+}
+
+void stream_consumer::write()
+{
+  if (is_writing_ || write_buffer_.empty())
+    return;
+  is_writing_ = true;
+
+  // the next round can be appended while this one is being written
+  std::swap(write_buffer_, sending_buffer_);
+
+  stream_.async_write(boost::asio::buffer(sending_buffer_),
+                      [this](auto&& ec, size_t)
+                      {
+                        is_writing_ = false;
+                        sending_buffer_.clear();
+
+                        if (!ec)
+                          write();
+                      });
+}
+
+void stream_consumer::read()
+{
+  if (is_reading_ || expected_.empty())
+    return;
+  is_reading_ = true;
+
+  stream_.async_read_some(read_buffer_.prepare(DEFAULT_CONSUMER_READ_SIZE),
+                          [this](auto&& ec, size_t read_bytes)
+                          { on_read(ec, read_bytes); });
+}
+
+void stream_consumer::on_read(boost::system::error_code const& ec,
+                              size_t read_bytes)
+{
+  is_reading_ = false;
+
+  if (ec)
+    return;
+
+  read_buffer_.commit(read_bytes);
+
+  while (!expected_.empty())
+  {
+    resp_reader r((const char*) read_buffer_.data().data(),
+                  read_buffer_.size());
+
+    auto kind = expected_.front();
+    if (kind == reply_kind::read)
+    {
+      batch_.clear();
+      if (!batch_.parse(r))
+        break;
+
+      expected_.pop_front();
+
+      // the entries point into read_buffer_, consume it afterwards
+      on_batch();
+      read_buffer_.consume(r.position());
+
+      if (!is_running_)
+      {
+        round(false);
+      }
+      else if (!batch_.error_.empty())
+      {
+        retry_timer_.expires_after(std::chrono::seconds(1));
+        retry_timer_.async_wait(
+            [this](auto&& ec)
+            {
+              if (!ec && is_running_)
+                round(true);
+            });
+      }
+      else
+      {
+        round(true);
+      }
+
+      continue;
+    }
+
+    resp_reader::value v;
+    if (!r.next(v))
+      break;
+
+    expected_.pop_front();
+
+    // the group already existing is fine
+    if (v.type == '-' &&
+        !(kind == reply_kind::group && v.data.substr(0, 9) == "BUSYGROUP"))
+    {
+      report(v.data);
+    }
+
+    read_buffer_.consume(r.position());
+  }
+
+  read();
+}
+
+void stream_consumer::report(std::string_view error)
+{
+  if (!on_error_cb_)
+    return;
+
+  redis::types::error e;
+  e = std::string(error);
+
+  on_error_cb_(e);
+}
+}  // namespace redis
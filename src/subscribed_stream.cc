@@ -1,12 +1,24 @@
+#include <redis/resp_reader.hpp>
 #include <redis/subscribed_stream.hpp>
 
+#include <algorithm>
+
 namespace redis
 {
 subscribed_stream::subscribed_stream(boost::asio::io_context& ioc)
     : stream_(ioc)
+    , missing_(0)
     , is_reading_(false)
     , is_writing_(false)
 {
+  // a message cut short by the lost connection is never completed, the new
+  // connection starts with the replies of the resubscription
+  stream_.set_on_stream_closed(
+      [this](auto&&)
+      {
+        read_buffer_.consume(read_buffer_.size());
+        missing_ = 0;
+      });
   stream_.set_on_reconnect(
       [this]()
       {
@@ -45,29 +57,36 @@ void subscribed_stream::connect(const std::string& host,
   stream_.connect(host, port, ec);
 }
 
-void subscribed_stream::async_connect(const std::string& hostport,
-                                      basic_stream::on_connect_cb cb) noexcept
+void subscribed_stream::set_workers(size_t threads, size_t queue_size)
 {
-  stream_.async_connect(hostport, cb);
+  workers_.reset();
+
+  if (threads > 0)
+    workers_ = std::make_unique<message_workers>(threads, queue_size);
 }
 
-void subscribed_stream::async_connect(const std::string& host,
-                                      const std::string& port,
-                                      basic_stream::on_connect_cb cb) noexcept
+void subscribed_stream::subscribe(const std::string& topic, message_cb cb)
 {
-  stream_.async_connect(host, port, cb);
+  subscribe(topic, std::hash<std::string>{}(topic), cb);
 }
 
-void subscribed_stream::subscribe(const std::string& topic, message_cb cb)
+void subscribed_stream::subscribe(const std::string& topic, size_t worker,
+                                  message_cb cb)
 {
   subscription_meta_.insert({topic, subscription_type::normal});
-  subscribe("SUBSCRIBE", topic, cb);
+  subscribe("SUBSCRIBE", topic, worker, cb);
 }
 
 void subscribed_stream::psubscribe(const std::string& topic, message_cb cb)
+{
+  psubscribe(topic, std::hash<std::string>{}(topic), cb);
+}
+
+void subscribed_stream::psubscribe(const std::string& topic, size_t worker,
+                                   message_cb cb)
 {
   subscription_meta_.insert({topic, subscription_type::regex});
-  subscribe("PSUBSCRIBE", topic, cb);
+  subscribe("PSUBSCRIBE", topic, worker, cb);
 }
 
 bool subscribed_stream::unsubscribe(const std::string& topic)
@@ -109,29 +128,22 @@ bool subscribed_stream::unsubscribe(const std::string& topic)
 void subscribed_stream::unsubscribe(std::string_view command,
                                     const std::string& topic)
 {
-  std::ostream os(&write_buffer_);
-
-  os << "*2\r\n"
-     << "$" << command.size() << "\r\n"
-     << command << "\r\n"
-     << "$" << topic.size() << "\r\n"
-     << topic << "\r\n";
+  command::encode(write_buffer_, std::string(command), topic);
 
   write();
 }
 
 void subscribed_stream::subscribe(std::string_view command,
-                                  const std::string& topic, message_cb cb)
+                                  const std::string& topic, size_t worker,
+                                  message_cb cb)
 {
-  auto sub_it = subscriptions_.insert({topic, cb});
-
-  std::ostream os(&write_buffer_);
+  if (cb)
+  {
+    subscriptions_.insert(
+        {topic, {std::make_shared<const message_cb>(std::move(cb)), worker}});
+  }
 
-  os << "*2\r\n"
-     << "$" << command.size() << "\r\n"
-     << command << "\r\n"
-     << "$" << topic.size() << "\r\n"
-     << topic << "\r\n";
+  command::encode(write_buffer_, std::string(command), topic);
 
   write();
   read();
@@ -145,15 +157,14 @@ void subscribed_stream::resubscribe()
     if (it == subscriptions_.end())
       continue;
 
-    auto&& cb = it->second;
-
+    // the subscription is already registered, only send the command again
     switch (type)
     {
       case subscription_type::normal:
-        subscribe(topic, cb);
+        subscribe("SUBSCRIBE", topic, it->second.worker, nullptr);
         break;
       case subscription_type::regex:
-        psubscribe(topic, cb);
+        subscribe("PSUBSCRIBE", topic, it->second.worker, nullptr);
         break;
     }
   }
@@ -161,23 +172,24 @@ void subscribed_stream::resubscribe()
 
 void subscribed_stream::write()
 {
-  if (write_buffer_.size() == 0)
+  if (write_buffer_.empty())
     return;
 
   if (is_writing_)
     return;
-  is_writing_ = false;
+  is_writing_ = true;
 
-  stream_.async_write(write_buffer_,
-                      [this](auto&& ec, size_t bytes_written)
+  // new commands keep going to write_buffer_ while this one is written
+  std::swap(write_buffer_, sending_buffer_);
+
+  stream_.async_write(boost::asio::buffer(sending_buffer_),
+                      [this](auto&& ec, size_t)
                       {
                         is_writing_ = false;
+                        sending_buffer_.clear();
 
                         if (!ec)
-                        {
-                          write_buffer_.consume(bytes_written);
                           write();
-                        }
                       });
 }
 
@@ -187,7 +199,9 @@ void subscribed_stream::read()
     return;
   is_reading_ = true;
 
-  stream_.async_read_some(read_buffer_.prepare(DEFAULT_READ_SIZE),
+  size_t size = std::max<size_t>(DEFAULT_READ_SIZE, missing_);
+
+  stream_.async_read_some(read_buffer_.prepare(size),
                           [this](auto&& ec, size_t read_bytes)
                           { on_read(ec, read_bytes); });
 }
@@ -202,25 +216,53 @@ void subscribed_stream::on_read(boost::system::error_code const& ec,
 
   read_buffer_.commit(read_bytes);
 
-  size_t parsed_bytes = parser_.parse((const char*) read_buffer_.data().data(),
-                                      read_buffer_.size());
-  if (!parser_.need_more())
+  if (read_bytes < missing_)
   {
+    missing_ -= read_bytes;
+    read();
+    return;
+  }
+
+  // a single read can carry several messages
+  while (read_buffer_.size() > 0)
+  {
+    size_t parsed_bytes = parser_.parse(
+        (const char*) read_buffer_.data().data(), read_buffer_.size());
+    if (parser_.need_more() || parsed_bytes == 0)
+      break;
+
     read_buffer_.consume(parsed_bytes);
 
+    message_parser_.reset();
     boost::variant2::visit(message_parser_, *parser_);
 
     if (message_parser_)
-    {
-      auto&& it = subscriptions_.find(message_parser_.channel);
-      if (it != subscriptions_.end())
-      {
-        it->second(message_parser_.target_channel, message_parser_.message);
-      }
-    }
+      dispatch();
   }
 
+  missing_ = resp_reader::missing((const char*) read_buffer_.data().data(),
+                                  read_buffer_.size());
+
   read();
 }
 
+void subscribed_stream::dispatch()
+{
+  auto&& it = subscriptions_.find(message_parser_.channel);
+  if (it == subscriptions_.end())
+    return;
+
+  auto&& sub = it->second;
+  if (workers_)
+  {
+    workers_->dispatch(sub.worker, sub.cb,
+                       std::move(message_parser_.target_channel),
+                       std::move(message_parser_.message));
+  }
+  else
+  {
+    (*sub.cb)(message_parser_.target_channel, message_parser_.message);
+  }
+}
+
 }  // namespace redis
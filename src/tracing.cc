@@ -0,0 +1,29 @@
+#include <redis/tracing.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace redis::trace
+{
+static std::atomic<tracer*> current(nullptr);
+
+void set_tracer(std::shared_ptr<tracer> t)
+{
+  // the tracers set are never released, a stream may be delivering an event
+  // to the previous one
+  static std::mutex mutex;
+  static std::vector<std::shared_ptr<tracer>> tracers;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  current.store(t.get(), std::memory_order_release);
+  if (t)
+    tracers.push_back(std::move(t));
+}
+
+tracer* get_tracer() noexcept
+{
+  return current.load(std::memory_order_acquire);
+}
+}  // namespace redis::trace
@@ -0,0 +1,31 @@
+#include <redis/transaction.hpp>
+
+namespace redis
+{
+transaction_result::transaction_result(any_type reply)
+    : reply_(std::move(reply))
+{
+}
+
+bool transaction_result::aborted() const
+{
+  auto v = boost::variant2::get_if<redis::types::vector>(&reply_);
+  return v != nullptr && v->is_null();
+}
+
+const redis::types::error* transaction_result::error() const
+{
+  return boost::variant2::get_if<redis::types::error>(&reply_);
+}
+
+size_t transaction_result::size() const
+{
+  auto v = boost::variant2::get_if<redis::types::vector>(&reply_);
+  return v != nullptr ? (**v).size() : 0;
+}
+
+auto transaction_result::operator[](size_t pos) -> any_type&
+{
+  return (*boost::variant2::get<redis::types::vector>(reply_))[pos];
+}
+}  // namespace redis
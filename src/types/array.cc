@@ -1,11 +1,15 @@
+#include <redis/byte_scan.hpp>
 #include <redis/types/array.hpp>
 
+#include <charconv>
+
 namespace redis::types
 {
 // array
 // * arrays
 vector::vector()
     : is_null_(false)
+    , has_header_(false)
     , expected_length_(0)
     , processed_(0)
 {
@@ -13,8 +17,10 @@ vector::vector()
 
 vector::vector(std::initializer_list<any_type> list)
     : vs_(list)
-    , expected_length_(0)
-    , processed_(0)
+    , is_null_(false)
+    , has_header_(true)
+    , expected_length_(list.size())
+    , processed_(list.size())
 {
 }
 
@@ -24,23 +30,28 @@ void vector::reset()
   expected_length_ = 0;
   processed_       = 0;
   is_null_         = false;
+  has_header_      = false;
 }
 
 size_t vector::parse(const char* s, size_t n)
 {
   size_t i = 0;
 
-  if (vs_.empty())
+  if (!has_header_)
   {
-    while (i < n && s[i++] != '*')
-      ;
+    i = find_prefix(s, n);  // advance to the *
+    if (i++ == n)
+      return n;
 
-    if (!(is_null_ = (s[i] == '-')))
-      expected_length_ = atoll(&s[i]);
+    size_t end = i + find_crlf(&s[i], n - i);
+    if (end == n)
+      return n;
 
-    while (i < n && s[i++] != '\n')
-      ;
+    has_header_ = true;
+    if (!(is_null_ = (s[i] == '-')))
+      std::from_chars(&s[i], &s[end], expected_length_);
 
+    i = end + 2;
     if (is_null_)
       return i;
   }
@@ -54,8 +65,8 @@ size_t vector::parse(const char* s, size_t n)
       case '+':
       {
         string v;
-        size_t pr = v.parse(&s[i], n);
-        if (!(need_more = !v))
+        size_t pr = v.parse(&s[i], n - i);
+        if (!(need_more = !v.complete()))
         {
           i += pr;
           vs_.push_back(v);
@@ -66,8 +77,8 @@ size_t vector::parse(const char* s, size_t n)
       case '-':
       {
         error v;
-        size_t pr = v.parse(&s[i], n);
-        if (!(need_more = !v))
+        size_t pr = v.parse(&s[i], n - i);
+        if (!(need_more = !v.complete()))
         {
           i += pr;
           vs_.push_back(v);
@@ -78,8 +89,8 @@ size_t vector::parse(const char* s, size_t n)
       case ':':
       {
         integer v;
-        size_t pr = v.parse(&s[i], n);
-        if (!(need_more = !v))
+        size_t pr = v.parse(&s[i], n - i);
+        if (!(need_more = !v.complete()))
         {
           i += pr;
           vs_.push_back(v);
@@ -90,8 +101,8 @@ size_t vector::parse(const char* s, size_t n)
       case '*':
       {
         vector v;
-        size_t pr = v.parse(&s[i], n);
-        if (!(need_more = !v))
+        size_t pr = v.parse(&s[i], n - i);
+        if (!(need_more = !v.complete()))
         {
           i += pr;
           vs_.push_back(v);
@@ -100,7 +111,8 @@ size_t vector::parse(const char* s, size_t n)
       }
       break;
       default:
-        i++;
+        // not a value, jump to the next one
+        i += find_prefix(&s[i], n - i);
         break;
     }
   }
@@ -118,6 +130,18 @@ void vector::serialize(std::ostream& os) const
   }
 }
 
+void vector::serialize(std::string& out) const
+{
+  out += '*';
+  out += std::to_string(vs_.size());
+  out += "\r\n";
+
+  for (auto& v : vs_)
+  {
+    boost::variant2::visit([&](auto const& e) { e.serialize(out); }, v);
+  }
+}
+
 size_t vector::expected_length() const
 {
   return expected_length_;
@@ -143,6 +167,16 @@ vector::operator bool() const
   return not is_null_ && processed_ == expected_length_ && not vs_.empty();
 }
 
+bool vector::is_null() const
+{
+  return is_null_;
+}
+
+bool vector::complete() const
+{
+  return has_header_ && (is_null_ || processed_ == expected_length_);
+}
+
 void vector::clear()
 {
   vs_.clear();
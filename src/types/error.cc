@@ -1,3 +1,4 @@
+#include <redis/byte_scan.hpp>
 #include <redis/types/error.hpp>
 
 namespace redis::types
@@ -6,27 +7,22 @@ namespace redis::types
 // - error
 size_t error::parse(const char* s, size_t n)
 {
-  size_t i   = 0;
-  size_t len = 0;
-
   expected_length_ = 0;
+  complete_        = false;
   e_.clear();
 
-  while (i < n && s[i++] != '-')
-    ;  // advance to the -
-  size_t start = i;
-  while (i < n && s[i++] != '\r')
-    len++;
-
-  if (i < n)
-  {
-    e_.assign(&s[start], len);
-  }
-  // advance the cursor
-  while (i < n && s[i++] != '\n')
-    ;
-
-  return i;
+  size_t i = find_prefix(s, n);  // advance to the -
+  if (i++ == n)
+    return n;
+
+  size_t end = i + find_crlf(&s[i], n - i);
+  if (end == n)
+    return n;
+
+  e_.assign(&s[i], end - i);
+  complete_ = true;
+
+  return end + 2;
 }
 
 void error::serialize(std::ostream& os) const
@@ -34,11 +30,23 @@ void error::serialize(std::ostream& os) const
   os << '-' << e_ << "\r\n";
 }
 
+void error::serialize(std::string& out) const
+{
+  out += '-';
+  out += e_;
+  out += "\r\n";
+}
+
 error::operator bool() const
 {
   return not e_.empty();
 }
 
+bool error::complete() const
+{
+  return complete_;
+}
+
 const std::string& error::operator*() const
 {
   return e_;
@@ -46,7 +54,8 @@ const std::string& error::operator*() const
 
 error& error::operator=(const std::string& e)
 {
-  e_ = e;
+  e_        = e;
+  complete_ = true;
   return *this;
 }
 
@@ -1,16 +1,21 @@
+#include <redis/byte_scan.hpp>
 #include <redis/types/integer.hpp>
 
+#include <charconv>
+
 namespace redis::types
 {
 // integer
 // : integer
 integer::integer(int64_t n)
     : n_(n)
+    , has_value_(true)
 {
 }
 
 integer::integer(int n)
     : n_(static_cast<int64_t>(n))
+    , has_value_(true)
 {
 }
 
@@ -20,18 +25,18 @@ size_t integer::parse(const char* s, size_t n)
   n_         = 0;
   has_value_ = false;
 
-  while (i < n && s[i++] != ':')
-    ;  // advance to the -
-  size_t start = i;
-  while (i < n && s[++i] != '\n')
-    ;
-  if (i++ < n)
-  {
-    has_value_ = true;
-    n_         = atoll(&s[start]);
-  }
+  i = find_prefix(s, n);  // advance to the :
+  if (i++ == n)
+    return n;
+
+  size_t end = i + find_crlf(&s[i], n - i);
+  if (end == n)
+    return n;
+
+  has_value_ = true;
+  std::from_chars(&s[i], &s[end], n_);
 
-  return i;
+  return end + 2;
 }
 
 void integer::serialize(std::ostream& os) const
@@ -39,6 +44,13 @@ void integer::serialize(std::ostream& os) const
   os << ':' << n_ << "\r\n";
 }
 
+void integer::serialize(std::string& out) const
+{
+  out += ':';
+  out += std::to_string(n_);
+  out += "\r\n";
+}
+
 int64_t integer::operator*() const
 {
   return n_;
@@ -49,6 +61,11 @@ integer::operator bool() const
   return has_value_;
 }
 
+bool integer::complete() const
+{
+  return has_value_;
+}
+
 integer& integer::operator=(int64_t n)
 {
   n_ = n;
@@ -1,21 +1,28 @@
+#include <redis/number.hpp>
+#include <redis/byte_scan.hpp>
 #include <redis/types/string.hpp>
 
+#include <charconv>
+
 namespace redis::types
 {
 string::string()
     : is_null_(false)
+    , complete_(false)
 {
 }
 
 string::string(double d)
     : is_null_(false)
-    , s_(std::move(std::to_string(d)))
+    , complete_(true)
 {
+  append_double(s_, d);
 }
 
 string::string(const std::string& s)
-    : is_null_(false)
-    , s_(s)
+    : s_(s)
+    , is_null_(false)
+    , complete_(true)
 {
 }
 
@@ -31,9 +38,11 @@ size_t string::parse(const char* s, size_t n)
   s_.clear();
   expected_length_ = 0;
   is_null_         = false;
+  complete_        = false;
 
-  while (i < n && s[i] != '+' && s[i] != '$')
-    i++;  // advance to the + or $
+  i = find_prefix(s, n);  // advance to the + or $
+  if (i == n)
+    return i;
 
   if (s[i++] == '+')
     i += parse_simple(&s[i], n - i);
@@ -45,7 +54,24 @@ size_t string::parse(const char* s, size_t n)
 
 void string::serialize(std::ostream& os, bool is_bulk) const
 {
-  is_bulk ? serialize_bulk(os) : serialize_simple(os);
+  is_bulk || is_binary() ? serialize_bulk(os) : serialize_simple(os);
+}
+
+void string::serialize(std::string& out, bool is_bulk) const
+{
+  if (is_bulk || is_binary())
+  {
+    out += '$';
+    out += std::to_string(s_.size());
+    out += "\r\n";
+  }
+  else
+  {
+    out += '+';
+  }
+
+  out += s_;
+  out += "\r\n";
 }
 
 string::operator bool() const
@@ -53,6 +79,11 @@ string::operator bool() const
   return not is_null_ && not s_.empty();
 }
 
+bool string::complete() const
+{
+  return complete_;
+}
+
 const std::string& string::operator*() const
 {
   return s_;
@@ -79,26 +110,36 @@ size_t string::size() const
   return s_.size();
 }
 
+std::optional<double> string::to_double() const
+{
+  double d;
+  if (is_null_ || !parse_double(s_, d))
+    return std::nullopt;
+
+  return d;
+}
+
 std::string::value_type string::operator[](size_t pos)
 {
   return s_[pos];
 }
 
 // private:
+bool string::is_binary() const
+{
+  return s_.find_first_of("\r\n") != std::string::npos;
+}
+
 size_t string::parse_simple(const char* s, size_t n)
 {
-  size_t i = 0;
-  while (i < n && s[++i] != '\r')
-    ;
-  if (i < n)
-  {
-    s_.assign(s, i);
-  }
-  // advance the cursor
-  while (i < n && s[i++] != '\n')
-    ;
+  size_t end = find_crlf(s, n);
+  if (end == n)
+    return n;
 
-  return i;
+  s_.assign(s, end);
+  complete_ = true;
+
+  return end + 2;
 }
 
 void string::serialize_simple(std::ostream& os) const
@@ -108,29 +149,29 @@ void string::serialize_simple(std::ostream& os) const
 
 size_t string::parse_bulk(const char* s, size_t n)
 {
-  size_t i = 0;
-  is_null_ = s[0] == '-';
+  size_t end = find_crlf(s, n);
+  if (end == n)
+    return n;
+
+  size_t i = end + 2;
 
-  while (i < n && s[i++] != '\n')
-    ;
+  is_null_ = s[0] == '-';
   if (is_null_)
+  {
+    complete_ = true;
     return i;
+  }
 
-  expected_length_ = std::atoll(s);
+  std::from_chars(s, &s[end], expected_length_);
 
-  size_t start = i;
-  size_t len   = 0;
-  while (i < n && s[i++] != '\r')
-    len++;
-  if (len == expected_length_)
-  {
-    s_.assign(&s[start], len);
-    // advance the cursor
-    while (i < n && s[i++] != '\n')
-      ;
-  }
+  // the payload is jumped over using the declared length, not scanned
+  if (n - i < expected_length_ + 2)
+    return n;
 
-  return i;
+  s_.assign(&s[i], expected_length_);
+  complete_ = true;
+
+  return i + expected_length_ + 2;
 }
 
 void string::serialize_bulk(std::ostream& os) const
@@ -0,0 +1,66 @@
+#include "test.hpp"
+
+#include <redis/auto_batcher.hpp>
+#include <redis/mock_server.hpp>
+#include <redis/stream.hpp>
+
+#include <vector>
+
+// the merged commands complete in the order they were issued, and a read
+// sees the writes issued before it and none after
+int main()
+{
+  redis::mock_server server(1);
+  boost::asio::io_context ioc;
+
+  redis::stream redis(ioc);
+  redis.connect(server.address());
+
+  std::vector<int> order;
+  std::vector<std::optional<std::string>> got;
+
+  {
+    redis::auto_batcher batcher(redis);
+
+    auto set = [&](int i, const std::string& key, const std::string& value)
+    {
+      batcher.async_set(key, value,
+                        [&, i](boost::system::error_code ec)
+                        {
+                          CHECK(!ec);
+                          order.push_back(i);
+                        });
+    };
+    auto get = [&](int i, const std::string& key)
+    {
+      batcher.async_get(
+          key,
+          [&, i](boost::system::error_code ec, std::optional<std::string> v)
+          {
+            CHECK(!ec);
+            order.push_back(i);
+            got.push_back(std::move(v));
+          });
+    };
+
+    set(0, "a", "1");
+    set(1, "b", "1");
+    get(2, "a");
+    get(3, "b");
+    set(4, "a", "2");
+    get(5, "a");
+    get(6, "missing");
+
+    redis::test::run_until(ioc, [&] { return order.size() == 7; });
+  }
+
+  CHECK((order == std::vector<int>{0, 1, 2, 3, 4, 5, 6}));
+  CHECK((got == std::vector<std::optional<std::string>>{
+             "1", "1", "2", std::nullopt}));
+
+  // MSET, MGET, MSET, MGET
+  CHECK(server.get_stats().commands == 4);
+
+  redis.close();
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include "test.hpp"
+
+#include <redis/bulk_loader.hpp>
+#include <redis/error.hpp>
+#include <redis/mock_server.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// a file of commands is loaded whole, one cut short or that isn't RESP
+// fails the load
+namespace
+{
+struct load
+{
+  boost::system::error_code ec;
+  redis::bulk_loader::result result{0, 0};
+};
+
+load load_file(boost::asio::io_context& ioc, const std::string& address,
+               const std::string& contents, size_t chunk_size)
+{
+  auto path = "redis_test_bulk_loader_" + std::to_string(chunk_size);
+  std::ofstream(path, std::ios::binary) << contents;
+
+  redis::bulk_loader loader(ioc);
+  loader.set_chunk_size(chunk_size);
+  loader.connect(address);
+
+  load l;
+  bool done = false;
+  loader.async_load_file(path,
+                         [&](boost::system::error_code ec,
+                             const redis::bulk_loader::result& r)
+                         {
+                           l.ec     = ec;
+                           l.result = r;
+                           done     = true;
+                         });
+  redis::test::run_until(ioc, [&] { return done; });
+
+  loader.close();
+  std::remove(path.c_str());
+  return l;
+}
+}  // namespace
+
+int main()
+{
+  redis::mock_server server(1);
+  boost::asio::io_context ioc;
+
+  std::string commands;
+  for (int i = 0; i < 100; i++)
+  {
+    auto key = "key" + std::to_string(i);
+    commands += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" +
+                key + "\r\n$5\r\nvalue\r\n";
+  }
+
+  // chunks smaller than a command, then several commands at once
+  for (size_t chunk_size : {7, 100, 1 << 20})
+  {
+    auto l = load_file(ioc, server.address(), commands, chunk_size);
+    CHECK(!l.ec);
+    CHECK(l.result.commands == 100);
+    CHECK(l.result.errors == 0);
+  }
+
+  // the commands before the truncated one are still loaded
+  auto truncated = load_file(ioc, server.address(),
+                             commands + "*3\r\n$3\r\nSET\r\n$1\r\nk", 100);
+  CHECK(truncated.ec == redis::errc::malformed_command);
+  CHECK(truncated.result.commands == 100);
+
+  auto text = load_file(ioc, server.address(), "SET key value\n", 100);
+  CHECK(text.ec == redis::errc::malformed_command);
+  CHECK(text.result.commands == 0);
+
+  return 0;
+}
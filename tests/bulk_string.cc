@@ -0,0 +1,140 @@
+#include "test.hpp"
+
+#include <redis/commands.hpp>
+#include <redis/mock_server.hpp>
+#include <redis/parser.hpp>
+#include <redis/resp_reader.hpp>
+#include <redis/stream.hpp>
+
+#include <random>
+#include <string>
+
+// bulk strings are read by their length, whatever bytes they hold, and
+// however the reply is cut into reads: CR, LF and prefixes inside the value
+// never end it early, and a cut reply always waits for the rest
+namespace
+{
+std::string bulk(const std::string& value)
+{
+  return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+}
+
+// parses `reply` cut after each of its bytes, then whole
+void check_parser(const std::string& reply)
+{
+  for (size_t n = 1; n < reply.size(); n++)
+  {
+    redis::parser p;
+    p.parse(reply.data(), n);
+    CHECK(p.need_more());
+  }
+
+  redis::parser p;
+  CHECK(p.parse(reply.data(), reply.size()) == reply.size());
+  CHECK(!p.need_more());
+}
+}  // namespace
+
+int main()
+{
+  using namespace std::string_literals;
+  const std::string value = "a\r\nb\rc\n$3\r\n*1\r\n-ERR\r\n\0:1\r\n+OK"s;
+
+  // the parser
+  {
+    auto reply = bulk(value);
+    check_parser(reply);
+
+    redis::parser p;
+    p.parse(reply.data(), reply.size());
+    auto s = boost::variant2::get_if<redis::types::string>(&*p);
+    CHECK(s && **s == value);
+
+    auto array = "*2\r\n" + reply + ":7\r\n";
+    check_parser(array);
+
+    p.parse(array.data(), array.size());
+    auto v = boost::variant2::get_if<redis::types::vector>(&*p);
+    CHECK(v && (**v).size() == 2);
+
+    s = boost::variant2::get_if<redis::types::string>(&(**v)[0]);
+    CHECK(s && **s == value);
+  }
+
+  // how much of the value a cut reply still needs, once its length is read
+  {
+    auto reply  = bulk(value);
+    auto header = reply.find("\r\n") + 2;
+
+    for (size_t n = 0; n < reply.size(); n++)
+    {
+      size_t missing = redis::resp_reader::missing(reply.data(), n);
+      CHECK(missing == (n < header ? 0 : reply.size() - n));
+    }
+
+    CHECK(redis::resp_reader::missing(reply.data(), reply.size()) == 0);
+
+    redis::resp_reader r(reply.data(), reply.size());
+    redis::resp_reader::value v;
+    CHECK(r.next(v) && v.type == '$' && v.data == value && r.empty());
+  }
+
+  // a value that can't be a simple string is written as a bulk string
+  {
+    std::string out;
+    redis::types::string(value).serialize(out, false);
+    CHECK(out == bulk(value));
+
+    out.clear();
+    redis::types::string("OK").serialize(out, false);
+    CHECK(out == "+OK\r\n");
+  }
+
+  // through a stream, the replies written in pieces of random sizes
+  {
+    redis::mock_server server(1);
+    boost::asio::io_context ioc;
+
+    redis::stream redis(ioc);
+    redis.connect(server.address());
+
+    std::mt19937 random(1);
+    std::string large(1 << 20, '\0');
+    for (auto&& c : large)
+      c = "\r\n$*+-:x"[random() % 8];
+
+    for (auto&& [stored, split] :
+         {std::pair{value, 3}, std::pair{large, 65536}})
+    {
+      redis::mock_server::write_options options;
+      server.set_write_options(options);
+
+      bool set = false;
+      redis.async_write([&](boost::system::error_code ec, bool) { set = !ec; },
+                        redis::cmd::set("key", stored));
+      redis::test::run_until(ioc, [&] { return set; });
+
+      options.split        = split;
+      options.random_split = true;
+      server.set_write_options(options);
+
+      std::optional<std::string> got;
+      bool done = false;
+      redis.async_write(
+          [&](boost::system::error_code ec, std::optional<std::string> v)
+          {
+            CHECK(!ec);
+            got  = std::move(v);
+            done = true;
+          },
+          redis::cmd::get("key"));
+      redis::test::run_until(ioc, [&] { return done; });
+
+      CHECK(got == stored);
+    }
+
+    redis.close();
+  }
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include "test.hpp"
+
+#include <redis/byte_scan.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// every implementation of the scans finds the first CRLF and the first type
+// prefix wherever they are, across the 16 and 32 byte blocks they read and
+// cut at the end of the buffer
+namespace
+{
+using scan_fn = size_t (*)(const char*, size_t);
+
+size_t crlf_reference(const char* s, size_t n)
+{
+  auto p = std::string_view(s, n).find("\r\n");
+  return p == std::string_view::npos ? n : p;
+}
+
+size_t prefix_reference(const char* s, size_t n)
+{
+  auto p = std::string_view(s, n).find_first_of("+-:$*");
+  return p == std::string_view::npos ? n : p;
+}
+
+// scans a copy of `s` allocated to its exact size, so a read past the end
+// shows with a sanitizer
+size_t scan(scan_fn fn, const std::string& s)
+{
+  std::unique_ptr<char[]> copy(new char[s.size()]);
+  std::copy(s.begin(), s.end(), copy.get());
+
+  return fn(copy.get(), s.size());
+}
+
+// puts each pattern at every position of buffers of every size up to a few
+// blocks, cut if it goes past the end
+void check(scan_fn fn, scan_fn reference, char fill,
+           const std::vector<std::string>& patterns)
+{
+  for (size_t n = 0; n <= 100; n++)
+  {
+    std::string s(n, fill);
+    CHECK(scan(fn, s) == n);
+
+    for (auto&& pattern : patterns)
+    {
+      for (size_t p = 0; p < n; p++)
+      {
+        auto t = s;
+        t.replace(p, std::min(pattern.size(), n - p), pattern, 0, n - p);
+
+        CHECK(scan(fn, t) == reference(t.data(), t.size()));
+      }
+    }
+  }
+}
+
+void check_crlf(scan_fn fn)
+{
+  check(fn, crlf_reference, 'x',
+        {"\r", "\n", "\r\n", "\n\r", "\r\r\n", "\r\r", "x\r\n"});
+}
+
+void check_prefix(scan_fn fn)
+{
+  // the bytes next to the prefixes, one bit away from them
+  for (char fill : {'x', ',', '#', ')', ';', '%'})
+    check(fn, prefix_reference, fill,
+          {"+", "-", ":", "$", "*", "*-", "\r\n$"});
+}
+}  // namespace
+
+int main()
+{
+  check_crlf(redis::find_crlf);
+  check_prefix(redis::find_prefix);
+
+#ifdef REDIS_SCAN_X86
+  check_crlf(redis::detail::find_crlf_sse2);
+  check_prefix(redis::detail::find_prefix_sse2);
+
+  // skipped on a CPU without it
+  if (redis::detail::has_avx2())
+  {
+    check_crlf(redis::detail::find_crlf_avx2);
+    check_prefix(redis::detail::find_prefix_avx2);
+  }
+#endif
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include "test.hpp"
+
+#include <redis/mock_server.hpp>
+#include <redis/stream.hpp>
+#include <redis/subscribed_stream.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using mock = redis::mock_server;
+
+// the handshake goes first, ahead of the commands sent before it
+// completed, again on every reconnection and on every kind of connection,
+// and a refused one fails the connect
+int main()
+{
+  mock server(1);
+  std::mutex mutex;
+  std::vector<std::string> received;
+  std::string password = "secret";
+
+  auto record = [&](const std::string& reply)
+  {
+    return [&, reply](const mock::args& a)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      received.push_back(a[0]);
+
+      if (a[0] == "AUTH" && a.back() != password)
+        return mock::error("WRONGPASS invalid username-password pair");
+      return reply;
+    };
+  };
+  server.on("AUTH", record(mock::simple("OK")));
+  server.on("SELECT", record(mock::simple("OK")));
+  server.on("GET", record(mock::bulk("value")));
+
+  boost::asio::io_context ioc;
+
+  {
+    redis::stream redis(ioc);
+
+    redis::handshake_options options;
+    options.password = "secret";
+    options.database = 2;
+    redis.set_handshake(options);
+
+    boost::system::error_code connected = redis::errc::connection_lost;
+    redis.async_connect(server.address(), [&](auto ec) { connected = ec; });
+
+    bool done = false;
+    redis.async_write([&](redis::any_type) { done = true; }, "GET", "key");
+    redis::test::run_until(ioc, [&] { return done; });
+
+    CHECK(!connected);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      CHECK((received == std::vector<std::string>{"AUTH", "SELECT", "GET"}));
+      received.clear();
+    }
+
+    // the reply is lost with the connection, the next command waits for
+    // the handshake of the new one
+    server.drop_next_reply(1);
+    done = false;
+    redis.async_write([&](redis::any_type) { done = true; }, "GET", "key");
+    redis::test::run_until(ioc, [&] { return done; });
+
+    done = false;
+    redis.async_write([&](redis::any_type) { done = true; }, "GET", "key");
+    redis::test::run_until(ioc, [&] { return done; });
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      CHECK((received ==
+             std::vector<std::string>{"GET", "AUTH", "SELECT", "GET"}));
+      received.clear();
+    }
+
+    redis.close();
+  }
+
+  {
+    redis::subscribed_stream redis(ioc);
+
+    redis::handshake_options options;
+    options.password = "secret";
+    redis.set_handshake(options);
+    redis.connect(server.address());
+    redis.subscribe("channel", [](auto&&...) {});
+
+    auto auths = [&]
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return std::count(received.begin(), received.end(), "AUTH");
+    };
+    redis::test::run_until(ioc, [&] { return auths() == 1; });
+
+    server.disconnect();
+    redis::test::run_until(ioc, [&] { return auths() == 2; });
+
+    redis.close();
+    std::lock_guard<std::mutex> lock(mutex);
+    received.clear();
+  }
+
+  {
+    redis::stream redis(ioc);
+
+    redis::handshake_options options;
+    options.password = "wrong";
+    redis.set_handshake(options);
+
+    boost::system::error_code ec;
+    redis.connect(server.address(), ec);
+
+    CHECK(ec == redis::errc::handshake_failed);
+    CHECK(!redis);
+  }
+
+  {
+    redis::stream redis(ioc);
+
+    redis::handshake_options options;
+    options.password = "wrong";
+    redis.set_handshake(options);
+
+    boost::system::error_code connected;
+    bool done = false;
+    redis.async_connect(server.address(),
+                        [&](auto ec)
+                        {
+                          connected = ec;
+                          done      = true;
+                        });
+    redis::test::run_until(ioc, [&] { return done; });
+
+    CHECK(connected == redis::errc::handshake_failed);
+    CHECK(redis.handshake_error().rfind("WRONGPASS", 0) == 0);
+    CHECK(!redis);
+  }
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "test.hpp"
+
+#include <redis/number.hpp>
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+// parse_double reads every double the server sends, infinities with either
+// sign included, rejects anything else, and reads back exactly what
+// format_double wrote
+namespace
+{
+bool parses(const std::string& s, double expected)
+{
+  double d = 0;
+  return redis::parse_double(s, d) && d == expected;
+}
+
+bool rejects(const std::string& s)
+{
+  double d = 0;
+  return !redis::parse_double(s, d);
+}
+}  // namespace
+
+int main()
+{
+  const double inf = std::numeric_limits<double>::infinity();
+
+  CHECK(parses("0", 0));
+  CHECK(parses("1.5", 1.5));
+  CHECK(parses("-1.5", -1.5));
+  CHECK(parses("+1.5", 1.5));
+  CHECK(parses("3", 3));
+  CHECK(parses("1e3", 1000));
+  CHECK(parses("1.7976931348623157e308", std::numeric_limits<double>::max()));
+
+  CHECK(parses("inf", inf));
+  CHECK(parses("+inf", inf));
+  CHECK(parses("-inf", -inf));
+
+  // a single sign
+  CHECK(rejects("+-1"));
+  CHECK(rejects("-+1"));
+  CHECK(rejects("++1"));
+  CHECK(rejects("+-inf"));
+
+  // nothing but a number
+  CHECK(rejects(""));
+  CHECK(rejects("+"));
+  CHECK(rejects("-"));
+  CHECK(rejects("1.5x"));
+  CHECK(rejects(" 1.5"));
+  CHECK(rejects("1.5 "));
+  CHECK(rejects("one"));
+  CHECK(rejects("0x10"));
+
+  // round trip, whatever the value
+  for (double d : {0.1, -2.2250738585072014e-308, 1e300, 1.0 / 3, -0.0,
+                   std::numeric_limits<double>::denorm_min(), inf, -inf})
+  {
+    char buf[redis::max_double_length];
+    double back = 0;
+    CHECK(redis::parse_double(redis::format_double(d, buf), back));
+    CHECK(back == d);
+    CHECK(!std::signbit(d) || std::signbit(back));
+  }
+
+  return 0;
+}
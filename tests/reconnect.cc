@@ -0,0 +1,61 @@
+#include "test.hpp"
+
+#include <redis/commands.hpp>
+#include <redis/mock_server.hpp>
+#include <redis/stream.hpp>
+
+// the connection dropped in the middle of a reply: the command fails, the
+// partial reply is thrown away and the next commands get theirs whole
+int main()
+{
+  redis::mock_server server(1);
+  boost::asio::io_context ioc;
+
+  redis::stream redis(ioc);
+  redis.connect(server.address());
+
+  std::string value(100000, 'v');
+  bool set = false;
+  redis.async_write([&](boost::system::error_code ec, bool) { set = !ec; },
+                    redis::cmd::set("key", value));
+  redis::test::run_until(ioc, [&] { return set; });
+
+  // read in pieces, the first ones before the connection is dropped
+  redis::mock_server::write_options options;
+  options.split        = 4096;
+  options.random_split = true;
+  server.set_write_options(options);
+  server.drop_next_reply(10000);
+
+  boost::system::error_code lost;
+  bool done = false;
+  redis.async_write(
+      [&](boost::system::error_code ec, std::optional<std::string>)
+      {
+        lost = ec;
+        done = true;
+      },
+      redis::cmd::get("key"));
+  redis::test::run_until(ioc, [&] { return done; });
+
+  CHECK(lost == redis::errc::connection_lost);
+
+  // sent once reconnected
+  std::optional<std::string> got;
+  done = false;
+  redis.async_write(
+      [&](boost::system::error_code ec, std::optional<std::string> v)
+      {
+        CHECK(!ec);
+        got  = std::move(v);
+        done = true;
+      },
+      redis::cmd::get("key"));
+  redis::test::run_until(ioc, [&] { return done; });
+
+  CHECK(got == value);
+  CHECK(server.get_stats().connections == 2);
+
+  redis.close();
+  return 0;
+}
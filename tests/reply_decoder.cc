@@ -0,0 +1,166 @@
+#include "test.hpp"
+
+#include <redis/reply_decoder.hpp>
+
+#include <chrono>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// each reply_decoder turns the replies it accepts into its type and the
+// others into the error matching them, always consuming the whole reply, and
+// waits for more data while the reply is cut short
+namespace
+{
+template<class T>
+struct decoded
+{
+  T value{};
+  boost::system::error_code ec;
+};
+
+template<class T>
+decoded<T> decode(const std::string& reply)
+{
+  for (size_t n = 0; n < reply.size(); n++)
+  {
+    redis::resp_reader r(reply.data(), n);
+    T out{};
+    boost::system::error_code ec;
+    CHECK(!redis::decode_reply(r, out, ec));
+  }
+
+  redis::resp_reader r(reply.data(), reply.size());
+  decoded<T> d;
+  CHECK(redis::decode_reply(r, d.value, d.ec));
+  CHECK(r.empty());
+
+  return d;
+}
+
+const std::string nil       = "$-1\r\n";
+const std::string nil_array = "*-1\r\n";
+}  // namespace
+
+int main()
+{
+  using redis::errc;
+  using strings = std::vector<std::string>;
+  using entry   = std::pair<std::string, int>;
+  using scores  = std::vector<std::pair<std::string, double>>;
+  using hash    = std::map<std::string, int>;
+
+  // errors
+  CHECK(decode<std::string>("-ERR unknown\r\n").ec == errc::server_error);
+  CHECK(decode<std::string>("-WRONGTYPE Op\r\n").ec == errc::wrong_type);
+  CHECK(decode<std::string>("-NOSCRIPT No\r\n").ec == errc::no_script);
+  CHECK(decode<redis::ignore_t>("-ERR unknown\r\n").ec == errc::server_error);
+  CHECK(!decode<redis::ignore_t>("*2\r\n:1\r\n*1\r\n$1\r\na\r\n").ec);
+
+  // strings
+  {
+    auto d = decode<std::string>("$7\r\nhe\r\nllo\r\n");
+    CHECK(!d.ec && d.value == "he\r\nllo");
+    CHECK(decode<std::string>("+OK\r\n").value == "OK");
+    CHECK(decode<std::string>("$0\r\n\r\n").value.empty());
+    CHECK(decode<std::string>(nil).ec == errc::unexpected_reply);
+    CHECK(decode<std::string>(":1\r\n").ec == errc::unexpected_reply);
+  }
+
+  // integers, also from strings
+  {
+    CHECK(decode<int64_t>(":-42\r\n").value == -42);
+    CHECK(decode<int64_t>("$2\r\n42\r\n").value == 42);
+    CHECK(decode<int>("+7\r\n").value == 7);
+    CHECK(decode<int64_t>("$3\r\n4x2\r\n").ec == errc::unexpected_reply);
+    CHECK(decode<int64_t>("$0\r\n\r\n").ec == errc::unexpected_reply);
+    CHECK(decode<uint8_t>("$3\r\n256\r\n").ec == errc::unexpected_reply);
+    CHECK(decode<int64_t>(nil).ec == errc::unexpected_reply);
+  }
+
+  // doubles
+  {
+    CHECK(decode<double>("$3\r\n1.5\r\n").value == 1.5);
+    CHECK(decode<double>(":3\r\n").value == 3.0);
+    CHECK(decode<float>("$4\r\n-inf\r\n").value ==
+          -std::numeric_limits<float>::infinity());
+    CHECK(decode<double>("$3\r\none\r\n").ec == errc::unexpected_reply);
+    CHECK(decode<double>(nil).ec == errc::unexpected_reply);
+  }
+
+  // bool
+  {
+    CHECK(decode<bool>("+OK\r\n").value);
+    CHECK(decode<bool>(":1\r\n").value);
+    CHECK(!decode<bool>(":0\r\n").value);
+    CHECK(!decode<bool>(nil).value);
+    CHECK(!decode<bool>(nil_array).value);
+    CHECK(decode<bool>("*0\r\n").ec == errc::unexpected_reply);
+  }
+
+  // optional
+  {
+    CHECK(!decode<std::optional<std::string>>(nil).value);
+    CHECK(!decode<std::optional<std::string>>(nil_array).value);
+    CHECK(decode<std::optional<std::string>>("$1\r\nx\r\n").value == "x");
+    CHECK(decode<std::optional<int>>("$1\r\nx\r\n").ec ==
+          errc::unexpected_reply);
+  }
+
+  // arrays, an element that doesn't fit failing the whole reply
+  {
+    auto d = decode<strings>("*2\r\n$1\r\na\r\n+b\r\n");
+    CHECK(!d.ec && (d.value == strings{"a", "b"}));
+
+    CHECK(decode<strings>(nil_array).value.empty());
+    CHECK(decode<strings>("$1\r\na\r\n").ec == errc::unexpected_reply);
+    CHECK(decode<strings>("*3\r\n$1\r\na\r\n:1\r\n$1\r\nc\r\n").ec ==
+          errc::unexpected_reply);
+
+    auto nested =
+        decode<std::vector<std::vector<int>>>("*2\r\n*1\r\n:1\r\n*0\r\n");
+    CHECK((nested.value == std::vector<std::vector<int>>{{1}, {}}));
+  }
+
+  // pairs
+  {
+    auto d = decode<entry>("*2\r\n$1\r\nk\r\n:5\r\n");
+    CHECK(!d.ec && (d.value == entry{"k", 5}));
+    CHECK(decode<entry>("*3\r\n:1\r\n:2\r\n:3\r\n").ec ==
+          errc::unexpected_reply);
+
+    auto z = decode<scores>(
+        "*4\r\n$1\r\nb\r\n$1\r\n2\r\n$1\r\na\r\n$3\r\n1.5\r\n");
+    CHECK((z.value == scores{{"b", 2}, {"a", 1.5}}));
+    CHECK(decode<scores>("*1\r\n$1\r\na\r\n").ec == errc::unexpected_reply);
+  }
+
+  // durations
+  CHECK(decode<std::chrono::seconds>(":10\r\n").value ==
+        std::chrono::seconds(10));
+  CHECK(decode<std::chrono::milliseconds>(":-2\r\n").value.count() == -2);
+
+  // maps
+  {
+    const std::string reply =
+        "*4\r\n$1\r\nb\r\n$1\r\n2\r\n$1\r\na\r\n$1\r\n1\r\n";
+
+    auto m = decode<hash>(reply).value;
+    CHECK((m == hash{{"a", 1}, {"b", 2}}));
+
+    auto u = decode<std::unordered_map<std::string, int>>(reply).value;
+    CHECK(u.size() == 2 && u.at("a") == 1 && u.at("b") == 2);
+
+    auto f = decode<boost::container::flat_map<std::string, int>>(reply).value;
+    CHECK(f.size() == 2 && f.begin()->first == "a" && f.at("b") == 2);
+
+    CHECK(decode<hash>("*1\r\n$1\r\na\r\n").ec == errc::unexpected_reply);
+    CHECK(decode<hash>(nil_array).ec == errc::unexpected_reply);
+  }
+
+  return 0;
+}
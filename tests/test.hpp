@@ -0,0 +1,45 @@
+#ifndef REDIS_TEST_H
+#define REDIS_TEST_H
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// fails the test at once, with the line of the check
+#define CHECK(cond)                                                           \
+  do                                                                          \
+  {                                                                           \
+    if (!(cond))                                                              \
+    {                                                                         \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #cond " failed"        \
+                << std::endl;                                                 \
+      std::exit(1);                                                           \
+    }                                                                         \
+  } while (false)
+
+namespace redis::test
+{
+/**
+ * Runs the handlers until `done` returns true, failing the test if it still
+ *doesn't after 5 seconds.
+ **/
+template<class Predicate>
+void run_until(boost::asio::io_context& ioc, Predicate done)
+{
+  // stopped when the work of the previous call ran out
+  ioc.restart();
+
+  auto work     = boost::asio::make_work_guard(ioc);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+  while (!done())
+  {
+    CHECK(std::chrono::steady_clock::now() < deadline);
+    ioc.run_one_for(std::chrono::milliseconds(10));
+  }
+}
+}  // namespace redis::test
+
+#endif
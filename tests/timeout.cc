@@ -0,0 +1,144 @@
+#include "test.hpp"
+
+#include <redis/mock_server.hpp>
+#include <redis/stream.hpp>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// a command timed out completes at once, its late reply is read past and
+// the next command gets its own reply
+int main()
+{
+  redis::mock_server server(1);
+  boost::asio::io_context ioc;
+
+  redis::stream redis(ioc);
+  redis.connect(server.address());
+
+  redis::mock_server::write_options options;
+  options.latency = 100ms;
+  server.set_write_options(options);
+
+  boost::system::error_code timed_out;
+  std::string echoed;
+  int done = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  redis.async_write(
+      [&](boost::system::error_code ec, std::string)
+      {
+        timed_out = ec;
+        done++;
+
+        // long before the reply
+        CHECK(std::chrono::steady_clock::now() - start < 100ms);
+      },
+      redis::typed_command<std::string>("ECHO", "late"), 20ms);
+  redis.async_write(
+      [&](boost::system::error_code ec, std::string v)
+      {
+        CHECK(!ec);
+        echoed = std::move(v);
+        done++;
+      },
+      redis::typed_command<std::string>("ECHO", "next"));
+  redis::test::run_until(ioc, [&] { return done == 2; });
+
+  CHECK(timed_out == redis::errc::timeout);
+  CHECK(echoed == "next");
+
+  // still on the same connection
+  CHECK(server.get_stats().connections == 1);
+
+  // the late replies keep their places among those awaited: every command
+  // still waited for gets its own, however the timeouts are interleaved
+  std::vector<std::string> replies;
+  int timeouts = 0;
+
+  for (int i = 0; i < 6; i++)
+  {
+    auto name = std::to_string(i);
+
+    if (i % 3 == 2)
+    {
+      redis.async_write(
+          [&](boost::system::error_code ec, std::string v)
+          {
+            CHECK(!ec);
+            replies.push_back(std::move(v));
+          },
+          redis::typed_command<std::string>("ECHO", name));
+    }
+    else
+    {
+      redis.async_write(
+          [&](boost::system::error_code ec, std::string)
+          {
+            CHECK(ec == redis::errc::timeout);
+            timeouts++;
+          },
+          redis::typed_command<std::string>("ECHO", name), 20ms);
+    }
+  }
+  redis::test::run_until(ioc, [&] { return replies.size() == 2; });
+
+  CHECK(timeouts == 4);
+  CHECK((replies == std::vector<std::string>{"2", "5"}));
+
+  // the commands timed out in a lane, never written, don't count toward
+  // recycling the connection: only their late replies would be awaited
+  redis.set_command_timeout(0s, 3);
+  redis.set_lane_limit(redis::priority::low, 1);
+
+  timeouts = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    redis.async_write(
+        [&](boost::system::error_code ec, std::string)
+        {
+          CHECK(ec == redis::errc::timeout);
+          timeouts++;
+        },
+        redis::typed_command<std::string>("ECHO", "queued"),
+        redis::priority::low, 20ms);
+  }
+
+  echoed.clear();
+  redis.async_write(
+      [&](boost::system::error_code ec, std::string v)
+      {
+        CHECK(!ec);
+        echoed = std::move(v);
+      },
+      redis::typed_command<std::string>("ECHO", "last"), redis::priority::low);
+  redis::test::run_until(ioc, [&] { return !echoed.empty(); });
+
+  CHECK(timeouts == 5);
+  CHECK(echoed == "last");
+  CHECK(server.get_stats().connections == 1);
+
+  redis.close();
+
+  // closed and destroyed with a late reply still to come
+  {
+    redis::stream closing(ioc);
+    closing.connect(server.address());
+
+    bool done = false;
+    closing.async_write([&](boost::system::error_code, std::string)
+                        { done = true; },
+                        redis::typed_command<std::string>("ECHO", "late"), 20ms);
+    redis::test::run_until(ioc, [&] { return done; });
+
+    closing.close();
+  }
+
+  // the read cancelled completes without the stream
+  auto after = std::chrono::steady_clock::now() + 200ms;
+  redis::test::run_until(
+      ioc, [&] { return std::chrono::steady_clock::now() > after; });
+
+  return 0;
+}